@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "../src/bitslice.hpp"
+
+// Same 64 link 8N1 fleet through the per device engine and the bit-sliced
+// one, both kept saturated. Reported as delivered frames per second.
+constexpr uint32_t link_count = bitslice_links;
+constexpr uint32_t frames_per_link = 20000;
+
+static double per_device_frames_per_second() {
+  constexpr UART_CONFIG bench_config = {.baud_rate = 9600,
+    .data_bits = 8,
+    .stop_bits = 1,
+    .start_bits = 1, };
+  std::unique_ptr<UART_DEVICE[]> devices = std::make_unique<UART_DEVICE[]>(link_count * 2);
+  std::unique_ptr<uint8_t[]> storage = std::make_unique<uint8_t[]>(link_count * 2 * 2 * buf_capacity_small);
+  for (uint32_t i = 0; i < link_count * 2; i++) {
+    devices[i].config = bench_config;
+    // time_per_byte stays 0, so every service_device() call moves a frame
+    attach_buffers(devices[i], &storage[(i * 2) * buf_capacity_small], buf_capacity_small,
+                   &storage[(i * 2 + 1) * buf_capacity_small], buf_capacity_small);
+  }
+  for (uint32_t i = 0; i < link_count; i++) {
+    serial_connection(devices[i * 2], devices[i * 2 + 1]);
+  }
+
+  uint64_t delivered = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < frames_per_link; frame++) {
+    for (uint32_t i = 0; i < link_count; i++) {
+      UART_DEVICE &sender = devices[i * 2];
+      UART_DEVICE &receiver = devices[i * 2 + 1];
+      push_tx_byte(sender, (uint8_t)(frame + i));
+      service_device(sender);
+      service_device(receiver);
+      uint8_t value = 0;
+      while (receiver.rx_fifo.pop(value)) {
+        delivered++;
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return (double)delivered / seconds;
+}
+
+static double bitslice_frames_per_second() {
+  static BITSLICE_LINKS links;
+  bitslice_init(links, link_count, 8, 1);
+
+  uint64_t delivered = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < frames_per_link; frame++) {
+    for (uint32_t i = 0; i < link_count; i++) {
+      bitslice_push(links, i, (uint8_t)(frame + i));
+    }
+    bitslice_step_n(links, links.frame_bits);
+    for (uint32_t i = 0; i < link_count; i++) {
+      uint8_t value = 0;
+      while (bitslice_pop(links, i, value)) {
+        delivered++;
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return (double)delivered / seconds;
+}
+
+// Lockstep fleet, bytes go in and out through one transpose per frame
+static double bitslice_direct_frames_per_second() {
+  static BITSLICE_LINKS links;
+  bitslice_init(links, link_count, 8, 1);
+  bitslice_set_direct(links, true);
+
+  uint8_t bytes[link_count];
+  uint64_t delivered = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < frames_per_link; frame++) {
+    for (uint32_t i = 0; i < link_count; i++) {
+      bytes[i] = (uint8_t)(frame + i);
+    }
+    bitslice_send(links, bytes, ~0ull);
+    bitslice_step_n(links, links.frame_bits);
+    delivered += (uint64_t)__builtin_popcountll(bitslice_receive(links, bytes));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return (double)delivered / seconds;
+}
+
+int main() {
+  double per_device = per_device_frames_per_second();
+  double bitslice = bitslice_frames_per_second();
+  double direct = bitslice_direct_frames_per_second();
+  std::cout << "bitslice_bench: " << link_count << " links x " << frames_per_link << " frames, 8N1" << std::endl;
+  std::cout << "  per device engine: " << per_device << " frames/s" << std::endl;
+  std::cout << "  bit-sliced engine: " << bitslice << " frames/s" << std::endl;
+  std::cout << "  bit-sliced direct: " << direct << " frames/s" << std::endl;
+  std::cout << "  speedup: " << (bitslice / per_device) << "x queued, " << (direct / per_device) << "x direct"
+            << std::endl;
+  return EXIT_SUCCESS;
+}
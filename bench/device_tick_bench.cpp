@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "../src/device.hpp"
+
+// Ticks a large fleet of linked device pairs so the working set is far
+// bigger than L1/L2 and the per-tick field layout decides the miss rate.
+constexpr uint32_t device_count = 65536;
+constexpr uint32_t tick_count = 2000;
+constexpr uint32_t storage_per_buf = buf_capacity_small;
+
+static void on_rx(UART_DEVICE &dev, UartEvent event, void *ctx) {
+  (void)event;
+  uint8_t sink[rx_fifo_capacity];
+  *static_cast<uint64_t *>(ctx) += read_rx_fifo(dev, sink, rx_fifo_capacity);
+}
+
+int main() {
+  constexpr UART_CONFIG bench_config = {.baud_rate = 9600,
+    .data_bits = 8,
+    .stop_bits = 1,
+    .start_bits = 1, };
+
+  std::unique_ptr<UART_DEVICE[]> devices = std::make_unique<UART_DEVICE[]>(device_count);
+  std::unique_ptr<uint8_t[]> storage = std::make_unique<uint8_t[]>(device_count * storage_per_buf * 2);
+
+  for (uint32_t i = 0; i < device_count; i++) {
+    UART_DEVICE &dev = devices[i];
+    dev.config = bench_config;
+    dev.calculate_timing();
+    uint8_t *tx_storage = &storage[(i * 2) * storage_per_buf];
+    uint8_t *rx_storage = &storage[(i * 2 + 1) * storage_per_buf];
+    attach_buffers(dev, tx_storage, storage_per_buf, rx_storage, storage_per_buf);
+    // Stagger clocks so devices fire on different ticks like a real fleet
+    dev.clock = dev.time_per_byte * (double)(i % 16) / 16.0;
+  }
+  // Visit devices in a scattered order, as a scheduler waking devices by
+  // deadline would, so the hardware prefetcher cannot hide the layout
+  std::unique_ptr<uint32_t[]> order = std::make_unique<uint32_t[]>(device_count);
+  uint32_t seed = 0x2545F491u;
+  for (uint32_t i = 0; i < device_count; i++) {
+    order[i] = i;
+  }
+  for (uint32_t i = device_count - 1; i > 0; i--) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t j = seed % (i + 1);
+    uint32_t tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+
+  uint64_t bytes_received = 0;
+  for (uint32_t i = 0; i < device_count; i += 2) {
+    serial_connection(devices[i], devices[i + 1]);
+    set_event_handler(devices[i + 1], (uint8_t)UartEvent::RX_READY, on_rx, &bytes_received);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < tick_count; tick++) {
+    for (uint32_t n = 0; n < device_count; n++) {
+      uint32_t i = order[n];
+      UART_DEVICE &dev = devices[i];
+      if ((i & 1) == 0 && dev.tx_buf.count() < 16) {
+        push_tx_byte(dev, (uint8_t)tick);
+      }
+      step_device(dev);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  double device_ticks = (double)device_count * (double)tick_count;
+  std::cout << "device_tick_bench: " << device_count << " devices x " << tick_count << " ticks" << std::endl;
+  std::cout << "  sizeof(UART_DEVICE): " << sizeof(UART_DEVICE) << " bytes" << std::endl;
+  std::cout << "  ns per device tick: " << (seconds * 1e9 / device_ticks) << std::endl;
+  std::cout << "  bytes received: " << bytes_received << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -7,10 +7,14 @@
  #include <cstdint>
  #include <iostream>
  #include <cstdlib>
+ #include <cstdio>
  #include <vector>
  #include <string>
  #include <memory>
+ #include <deque>
+ #include <chrono>
  #include "../src/device.hpp"
+ #include "../src/snapshot.hpp"
  
  #include "../imgui/imgui.h"
  #include "../imgui/backends/imgui_impl_glfw.h"
@@ -18,10 +22,6 @@
  
  #include <GLFW/glfw3.h>
  
- // UART bit definitions
- constexpr uint8_t start_bit = 0x00; // low line
- constexpr uint8_t stop_bit  = 0x01; // high line
- 
  // Convert string to bit array
  static std::unique_ptr<uint8_t[]> string_to_bits(const std::string& str_in) {
      uint32_t bit_arr_size = str_in.size() * 8;
@@ -37,90 +37,146 @@
      return bit_arr_ptr;
  }
  
- // Push bit array into UART TX buffer
- static void load_bit_array_tx(UART_DEVICE &dev, const uint8_t *bit_arr, uint32_t size) {
-     for (uint32_t i = 0; i < size; i++) {
-         dev.tx_buf.push(bit_arr[i]);
+ // Receiver side console, filled from uart_two's RX events
+ struct rx_console {
+     std::vector<uint8_t> reconstructed_string;
+     std::vector<std::string> uart_log;
+     size_t sent = 0;
+ };
+ 
+ // Drain decoded bytes as they arrive instead of polling every frame
+ static void on_uart_two_event(UART_DEVICE &dev, UartEvent event, void *ctx) {
+     rx_console &console = *static_cast<rx_console *>(ctx);
+     if (event != UartEvent::RX_READY) return;
+ 
+     uint8_t batch[rx_fifo_capacity];
+     uint32_t batch_size = read_rx_fifo(dev, batch, rx_fifo_capacity);
+     for (uint32_t i = 0; i < batch_size; i++) {
+         if (console.sent < console.reconstructed_string.size()) {
+             console.reconstructed_string[console.sent] = batch[i];
+             console.sent++;
+         }
+         // If complete, log it
+         if (console.sent == console.reconstructed_string.size()) {
+             std::string printable(console.reconstructed_string.begin(), console.reconstructed_string.end());
+             console.uart_log.push_back("UART TWO RECEIVED: " + printable);
+             console.sent = 0;
+         }
      }
  }
  
- // Update device state based on buffer activity
- static void transition_uart_state(UART_DEVICE &dev) {
-     if (!dev.rx_buf.is_empty()) {
-         if (dev.state == DeviceState::TRANSMITTING)
-             dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-         else
-             dev.state = DeviceState::RECEIVING;
-     }
-     if (!dev.tx_buf.is_empty()) {
-         if (dev.state == DeviceState::RECEIVING)
-             dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-         else
-             dev.state = DeviceState::TRANSMITTING;
-     }
+ // Rewind history: a device image plus the console it produced, taken every
+ // snapshot_interval ticks. Oldest checkpoints fall off the front.
+ constexpr uint64_t snapshot_interval = 120;
+ constexpr size_t snapshot_history = 32;
+ 
+ struct demo_checkpoint {
+     std::vector<uint8_t> image;
+     rx_console console;
+     uint64_t tick = 0;
+ };
+ 
+ // Performance samples, one slot per rendered frame. Recording is a handful
+ // of float stores so the panel costs the simulation nothing measurable; the
+ // plots read the ring in place through PlotLines' values_offset.
+ constexpr int perf_samples = 240;
+ constexpr int perf_devices = 2;
+ constexpr double perf_rate_window = 0.5; // Seconds between rate updates
+ 
+ struct perf_ring {
+     float step_us[perf_samples] = {};
+     float render_us[perf_samples] = {};
+     float tx_fill[perf_devices][perf_samples] = {};
+     float rx_fill[perf_devices][perf_samples] = {};
+     int head = 0;
+ };
+ 
+ // Frame counters at the start of the current rate window
+ struct perf_rates {
+     double window_start = 0.0;
+     uint32_t tx_frames[perf_devices] = {};
+     uint32_t rx_frames[perf_devices] = {};
+     float tx_bits_per_second[perf_devices] = {};
+     float tx_frames_per_second[perf_devices] = {};
+     float rx_frames_per_second[perf_devices] = {};
+ };
+ 
+ static float fill_ratio(const ext_ring_buffer<uint8_t> &buf) {
+     return buf.capacity() > 0 ? (float)buf.count() / (float)buf.capacity() : 0.0f;
  }
  
- // Reconstruct one byte from RX buffer
- static bool handle_receive(UART_DEVICE &dev, uint8_t &reconstructed_character) {
-     if (dev.state == DeviceState::RECEIVING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-         reconstructed_character = 0x00;
- 
-         uint8_t message_start;
-         if (!dev.rx_buf.peek(message_start)) return false;
- 
-         if (message_start == start_bit) {
-             uint8_t dummy;
-             dev.rx_buf.pop(dummy); // consume start bit
- 
-             for (uint32_t i = 0; i < dev.config.data_bits; i++) {
-                 uint8_t bit;
-                 if (dev.rx_buf.pop(bit)) {
-                     reconstructed_character = (reconstructed_character << 1) | bit;
-                 } else {
-                     // Buffer underrun - invalid frame
-                     dev.rx_buf.reset();
-                     dev.state = DeviceState::IDLE;
-                     return false;
-                 }
-             }
+ static void perf_record(perf_ring &ring, UART_DEVICE *const *devices, float step_us, float render_us) {
+     ring.step_us[ring.head] = step_us;
+     ring.render_us[ring.head] = render_us;
+     for (int i = 0; i < perf_devices; i++) {
+         ring.tx_fill[i][ring.head] = fill_ratio(devices[i]->tx_buf);
+         ring.rx_fill[i][ring.head] = fill_ratio(devices[i]->rx_buf);
+     }
+     ring.head = (ring.head + 1) % perf_samples;
+ }
  
-             uint8_t message_end;
-             if (dev.rx_buf.peek(message_end) && message_end == stop_bit) {
-                 dev.rx_buf.pop(message_end);
-                 dev.state = DeviceState::IDLE;
-                 return true;
-             } else {
-                 dev.rx_buf.reset();
-                 dev.state = DeviceState::IDLE;
-                 return false;
-             }
-         } else {
-             dev.rx_buf.reset();
-             dev.state = DeviceState::IDLE;
-             return false;
-         }
+ static void perf_update_rates(perf_rates &rates, UART_DEVICE *const *devices, double now) {
+     double elapsed = now - rates.window_start;
+     if (elapsed < perf_rate_window) return;
+     for (int i = 0; i < perf_devices; i++) {
+         const UART_DEVICE &dev = *devices[i];
+         // A rewind can move the counters back, restart the window from there
+         uint32_t tx = dev.tx_frames >= rates.tx_frames[i] ? dev.tx_frames - rates.tx_frames[i] : 0;
+         uint32_t rx = dev.rx_frames >= rates.rx_frames[i] ? dev.rx_frames - rates.rx_frames[i] : 0;
+         rates.tx_frames_per_second[i] = (float)(tx / elapsed);
+         rates.rx_frames_per_second[i] = (float)(rx / elapsed);
+         rates.tx_bits_per_second[i] = (float)((double)tx * (dev.config.data_bits + 2) / elapsed);
+         rates.tx_frames[i] = dev.tx_frames;
+         rates.rx_frames[i] = dev.rx_frames;
      }
-     return false;
+     rates.window_start = now;
  }
  
- // Transmit one frame of bits
- static void handle_transmit(UART_DEVICE &dev) {
-     if (dev.state == DeviceState::TRANSMITTING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-         send_bit(dev, start_bit);
- 
-         for (uint32_t i = 0; i < dev.config.data_bits; i++) {
-             uint8_t send_value;
-             if (dev.tx_buf.pop(send_value)) {
-                 send_bit(dev, send_value);
-             } else {
-                 // Buffer underrun - invalid frame
-                 dev.state = DeviceState::IDLE;
-                 return;
-             }
+ static float ring_average(const float *values) {
+     float sum = 0.0f;
+     for (int i = 0; i < perf_samples; i++) sum += values[i];
+     return sum / (float)perf_samples;
+ }
+ 
+ static void draw_perf_panel(const perf_ring &ring, const perf_rates &rates, UART_DEVICE *const *devices) {
+     if (!ImGui::CollapsingHeader("Performance")) return;
+ 
+     float step_avg = ring_average(ring.step_us);
+     float render_avg = ring_average(ring.render_us);
+     ImGui::Text("Sim step %.2f us, render %.2f us (%s bound)", step_avg, render_avg,
+                 step_avg > render_avg ? "simulation" : "render");
+     char overlay[64];
+     snprintf(overlay, sizeof(overlay), "step %.2f us", step_avg);
+     ImGui::PlotLines("##StepTime", ring.step_us, perf_samples, ring.head, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+     snprintf(overlay, sizeof(overlay), "render %.2f us", render_avg);
+     ImGui::PlotLines("##RenderTime", ring.render_us, perf_samples, ring.head, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+ 
+     if (ImGui::BeginTable("PerfDevices", 6)) {
+         ImGui::TableSetupColumn("Device");
+         ImGui::TableSetupColumn("TX bits/s");
+         ImGui::TableSetupColumn("TX frames/s");
+         ImGui::TableSetupColumn("RX frames/s");
+         ImGui::TableSetupColumn("Dropped bits");
+         ImGui::TableSetupColumn("Frame errors");
+         ImGui::TableHeadersRow();
+         for (int i = 0; i < perf_devices; i++) {
+             ImGui::TableNextRow();
+             ImGui::TableNextColumn(); ImGui::Text("UART %d", i + 1);
+             ImGui::TableNextColumn(); ImGui::Text("%.0f", rates.tx_bits_per_second[i]);
+             ImGui::TableNextColumn(); ImGui::Text("%.1f", rates.tx_frames_per_second[i]);
+             ImGui::TableNextColumn(); ImGui::Text("%.1f", rates.rx_frames_per_second[i]);
+             ImGui::TableNextColumn(); ImGui::Text("%u", devices[i]->dropped_bits);
+             ImGui::TableNextColumn(); ImGui::Text("%u", devices[i]->frame_errors);
          }
+         ImGui::EndTable();
+     }
  
-         send_bit(dev, stop_bit);
-         dev.state = DeviceState::IDLE;
+     for (int i = 0; i < perf_devices; i++) {
+         char label[32];
+         snprintf(label, sizeof(label), "UART %d tx_buf", i + 1);
+         ImGui::PlotLines(label, ring.tx_fill[i], perf_samples, ring.head, nullptr, 0.0f, 1.0f, ImVec2(0, 30));
+         snprintf(label, sizeof(label), "UART %d rx_buf", i + 1);
+         ImGui::PlotLines(label, ring.rx_fill[i], perf_samples, ring.head, nullptr, 0.0f, 1.0f, ImVec2(0, 30));
      }
  }
  
@@ -140,10 +196,28 @@
      UART_DEVICE uart_one = {.state = DeviceState::IDLE, .config = default_config};
      UART_DEVICE uart_two = {.state = DeviceState::IDLE, .config = default_config};
  
+     static uint8_t uart_one_tx[buf_capacity_large];
+     static uint8_t uart_one_rx[buf_capacity_large];
+     static uint8_t uart_two_tx[buf_capacity_large];
+     static uint8_t uart_two_rx[buf_capacity_large];
+     attach_buffers(uart_one, uart_one_tx, uart_one_rx);
+     attach_buffers(uart_two, uart_two_tx, uart_two_rx);
+ 
      uart_one.calculate_timing();
      uart_two.calculate_timing();
      serial_connection(uart_one, uart_two);
  
+     static rx_console console;
+     set_event_handler(uart_two, (uint8_t)UartEvent::RX_READY, on_uart_two_event, &console);
+ 
+     UART_DEVICE *devices[] = {&uart_one, &uart_two};
+     constexpr uint32_t device_count = 2;
+     std::deque<demo_checkpoint> history;
+     uint64_t sim_tick = 0;
+ 
+     static perf_ring perf;
+     static perf_rates rates;
+ 
      // Setup GLFW
      glfwSetErrorCallback(glfw_error_callback);
      if (!glfwInit()) {
@@ -176,11 +250,9 @@
  
      // Persistent state
      static char uart_input[128] = "";
-     static std::vector<uint8_t> reconstructed_string;
-     static std::vector<std::string> uart_log;
      static bool scroll_to_bottom = false;
      static bool want_focus = true;
-     static size_t sent = 0;
+     static int rewind_steps = 1;
  
      // Main loop
      while (!glfwWindowShouldClose(window)) {
@@ -188,6 +260,7 @@
          if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
              glfwSetWindowShouldClose(window, GLFW_TRUE);
  
+         auto frame_start = std::chrono::steady_clock::now();
          ImGui_ImplOpenGL3_NewFrame();
          ImGui_ImplGlfw_NewFrame();
          ImGui::NewFrame();
@@ -200,16 +273,37 @@
                           ImGuiWindowFlags_NoMove |
                           ImGuiWindowFlags_NoCollapse);
                         
+         draw_perf_panel(perf, rates, devices);
  
          // Log region
-         ImGui::BeginChild("LogRegion", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
-         for (const auto& line : uart_log) {
+         ImGui::BeginChild("LogRegion", ImVec2(0, -2.0f * ImGui::GetFrameHeightWithSpacing()), true);
+         for (const auto& line : console.uart_log) {
              ImGui::TextWrapped("%s", line.c_str());
          }
          if (scroll_to_bottom) ImGui::SetScrollHereY(1.0f);
          scroll_to_bottom = false;
          ImGui::EndChild();
  
+         // Rewind bar, restores a checkpoint and drops the ones after it
+         int checkpoints = (int)history.size();
+         ImGui::Text("Tick %llu, %d checkpoints", (unsigned long long)sim_tick, checkpoints);
+         ImGui::SameLine();
+         ImGui::SetNextItemWidth(160.0f);
+         ImGui::SliderInt("##RewindSteps", &rewind_steps, 1, checkpoints > 0 ? checkpoints : 1, "back %d");
+         ImGui::SameLine();
+         if (ImGui::Button("Rewind") && checkpoints > 0) {
+             int steps = rewind_steps < checkpoints ? rewind_steps : checkpoints;
+             history.resize(history.size() - (size_t)(steps - 1));
+             demo_checkpoint &checkpoint = history.back();
+             if (snapshot_restore(devices, device_count, nullptr, 0, checkpoint.image.data(),
+                                  (uint32_t)checkpoint.image.size())) {
+                 console = checkpoint.console;
+                 sim_tick = checkpoint.tick;
+                 scroll_to_bottom = true;
+             }
+             rewind_steps = 1;
+         }
+ 
          // Input line
          ImGui::SetNextItemWidth(-FLT_MIN);
          if (ImGui::InputText("##UARTInput", uart_input, IM_ARRAYSIZE(uart_input),
@@ -217,8 +311,8 @@
              if (uart_input[0] != '\0') {
                  std::string send_string(uart_input);
  
-                 reconstructed_string.clear();
-                 reconstructed_string.resize(send_string.size(), 0);
+                 console.reconstructed_string.clear();
+                 console.reconstructed_string.resize(send_string.size(), 0);
  
                  std::size_t send_size = send_string.size() * 8;
                  auto uart_in_ptr = string_to_bits(send_string);
@@ -229,7 +323,7 @@
                  uart_input[0] = '\0';
                  scroll_to_bottom = true;
                  want_focus = true;
-                 sent = 0;
+                 console.sent = 0;
              }
          }
  
@@ -239,39 +333,28 @@
          }
  
          // ---- FRAME-LEVEL UART SIMULATION ----
-         if (is_ready(uart_one)) {
-             reset_clock(uart_one);
-             transition_uart_state(uart_one);
-             handle_transmit(uart_one);
-         }
- 
-         if (is_ready(uart_two)) {
-             reset_clock(uart_two);
-             transition_uart_state(uart_two);
-             handle_transmit(uart_two);
- 
-             uint8_t rx_char;
-             if (handle_receive(uart_two, rx_char)) {
-                 if (sent < reconstructed_string.size()) {
-                     reconstructed_string[sent] = rx_char;
-                     sent++;
-                 }
-                 // If complete, log it
-                 if (sent == reconstructed_string.size()) {
-                     std::string printable(reconstructed_string.begin(), reconstructed_string.end());
-                     std::string log_entry = "UART TWO RECEIVED: " + printable;
-                     uart_log.push_back(log_entry);
-                     sent = 0;
-                 }
+         // Received bytes are delivered through on_uart_two_event
+         auto step_start = std::chrono::steady_clock::now();
+         step_n(devices, device_count, 1);
+         float step_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - step_start).count();
+ 
+         if (sim_tick++ % snapshot_interval == 0) {
+             demo_checkpoint checkpoint;
+             checkpoint.image.resize(snapshot_size(devices, device_count, 0));
+             snapshot_save(devices, device_count, nullptr, 0, checkpoint.image.data(),
+                           (uint32_t)checkpoint.image.size());
+             checkpoint.console = console;
+             checkpoint.tick = sim_tick;
+             history.push_back(std::move(checkpoint));
+             if (history.size() > snapshot_history) {
+                 history.pop_front();
              }
          }
  
-         tick_down(uart_one);
-         tick_down(uart_two);
- 
          ImGui::End();
  
-         // Rendering
+         // Render time is the rest of the frame up to the swap, so UI building
+         // counts and vsync waits do not
          int display_w, display_h;
          glfwGetFramebufferSize(window, &display_w, &display_h);
          ImGui::Render();
@@ -279,6 +362,10 @@
          glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
          glClear(GL_COLOR_BUFFER_BIT);
          ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+         float frame_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - frame_start).count();
+         float render_us = frame_us - step_us;
+         perf_record(perf, devices, step_us, render_us);
+         perf_update_rates(rates, devices, glfwGetTime());
          glfwSwapBuffers(window);
      }
  
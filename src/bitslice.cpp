@@ -0,0 +1,368 @@
+#include "bitslice.hpp"
+
+// Transpose of an 8x8 bit matrix held one row per byte: bit c of byte r
+// moves to bit r of byte c (Hacker's Delight 7-3)
+static inline uint64_t transpose8(uint64_t x) {
+  uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+  x = x ^ t ^ (t << 28);
+  return x;
+}
+
+// 64 bytes, one per link, into 8 planes where bit i of planes[b] is bit b of
+// link i's byte. The same transpose takes planes back to bytes.
+static void bytes_to_planes(const uint8_t *bytes, uint64_t *planes) {
+  for (uint32_t b = 0; b < 8; b++) {
+    planes[b] = 0;
+  }
+  for (uint32_t block = 0; block < bitslice_links / 8; block++) {
+    uint64_t rows = 0;
+    for (uint32_t link = 0; link < 8; link++) {
+      rows |= (uint64_t)bytes[block * 8 + link] << (8 * link);
+    }
+    uint64_t cols = transpose8(rows);
+    for (uint32_t b = 0; b < 8; b++) {
+      planes[b] |= ((cols >> (8 * b)) & 0xFF) << (8 * block);
+    }
+  }
+}
+
+static void planes_to_bytes(const uint64_t *planes, uint8_t *bytes) {
+  for (uint32_t block = 0; block < bitslice_links / 8; block++) {
+    uint64_t rows = 0;
+    for (uint32_t b = 0; b < 8; b++) {
+      rows |= ((planes[b] >> (8 * block)) & 0xFF) << (8 * b);
+    }
+    uint64_t cols = transpose8(rows);
+    for (uint32_t link = 0; link < 8; link++) {
+      bytes[block * 8 + link] = (uint8_t)(cols >> (8 * link));
+    }
+  }
+}
+
+static inline uint32_t lowest_link(uint64_t mask) { return (uint32_t)__builtin_ctzll(mask); }
+
+// Adds one to every link in mask, ripple carry across the planes. Half the
+// increments stop after the first plane, so this averages two word ops.
+static inline void count_links(uint64_t *planes, uint64_t mask) {
+  for (uint32_t plane = 0; plane < bitslice_counter_bits && mask != 0; plane++) {
+    uint64_t carry = planes[plane] & mask;
+    planes[plane] ^= mask;
+    mask = carry;
+  }
+}
+
+static uint32_t read_count(const uint64_t *planes, uint32_t link) {
+  uint32_t value = 0;
+  for (uint32_t plane = 0; plane < bitslice_counter_bits; plane++) {
+    value |= (uint32_t)((planes[plane] >> link) & 1) << plane;
+  }
+  return value;
+}
+
+static void write_count(uint64_t *planes, uint32_t link, uint32_t value) {
+  for (uint32_t plane = 0; plane < bitslice_counter_bits; plane++) {
+    planes[plane] = (planes[plane] & ~(1ull << link)) | ((uint64_t)((value >> plane) & 1) << link);
+  }
+}
+
+bool bitslice_init(BITSLICE_LINKS &links, uint32_t link_count, uint32_t data_bits, uint32_t stop_bits) {
+  if (link_count > bitslice_links || data_bits == 0 || data_bits > bitslice_max_data_bits || stop_bits == 0 ||
+      stop_bits > 2) {
+    return false;
+  }
+  links.active = link_count == bitslice_links ? ~0ull : (1ull << link_count) - 1;
+  for (uint32_t slot = 0; slot < bitslice_max_frame_bits; slot++) {
+    links.tx_frame[slot] = 0;
+    links.tx_valid[slot] = 0;
+    links.rx_next[slot] = 0;
+  }
+  for (uint32_t bit = 0; bit < bitslice_max_data_bits; bit++) {
+    links.rx_data[bit] = 0;
+    links.rx_latched[bit] = 0;
+  }
+  for (uint32_t plane = 0; plane < bitslice_counter_bits; plane++) {
+    links.tx_count[plane] = 0;
+    links.rx_count[plane] = 0;
+  }
+  links.rx_latched_mask = 0;
+  links.direct = false;
+  links.tx_ready = 0;
+  links.line = ~0ull;
+  links.data_bits = data_bits;
+  links.stop_bits = stop_bits;
+  links.frame_bits = 1 + data_bits + stop_bits;
+  links.periods = 0;
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    links.tx_queue[link].reset();
+    links.rx_queue[link].reset();
+    links.frame_errors[link] = 0;
+    links.rx_overruns[link] = 0;
+  }
+  return true;
+}
+
+bool bitslice_push(BITSLICE_LINKS &links, uint32_t link, uint8_t value) {
+  // A link outside active never starts, its queue would keep the fleet busy
+  if (link >= bitslice_links || ((links.active >> link) & 1) == 0 || !links.tx_queue[link].push(value)) {
+    return false;
+  }
+  links.tx_ready |= 1ull << link;
+  return true;
+}
+
+bool bitslice_pop(BITSLICE_LINKS &links, uint32_t link, uint8_t &value) {
+  return link < bitslice_links && links.rx_queue[link].pop(value);
+}
+
+// Starts a frame on every link in mask: start bit, data MSB first, stop bits
+static void load_frames(BITSLICE_LINKS &links, const uint8_t *bytes, uint64_t mask) {
+  uint64_t planes[8];
+  bytes_to_planes(bytes, planes);
+
+  const uint32_t data_bits = links.data_bits;
+  links.tx_frame[0] &= ~mask;
+  for (uint32_t slot = 1; slot <= data_bits; slot++) {
+    links.tx_frame[slot] = (links.tx_frame[slot] & ~mask) | (planes[data_bits - slot] & mask);
+  }
+  for (uint32_t slot = data_bits + 1; slot < links.frame_bits; slot++) {
+    links.tx_frame[slot] |= mask;
+  }
+  for (uint32_t slot = 0; slot < links.frame_bits; slot++) {
+    links.tx_valid[slot] |= mask;
+  }
+}
+
+static void load_queued_frames(BITSLICE_LINKS &links, uint64_t mask) {
+  uint8_t bytes[bitslice_links] = {};
+  for (uint64_t pending = mask; pending != 0; pending &= pending - 1) {
+    uint32_t link = lowest_link(pending);
+    links.tx_queue[link].pop(bytes[link]);
+    if (links.tx_queue[link].is_empty()) {
+      links.tx_ready &= ~(1ull << link);
+    }
+  }
+  load_frames(links, bytes, mask);
+}
+
+// Completed frames: latch the data planes as they are in direct mode,
+// otherwise assemble bytes and queue them
+static void deliver_frames(BITSLICE_LINKS &links, uint64_t done) {
+  if (links.direct) {
+    for (uint64_t overrun = done & links.rx_latched_mask; overrun != 0; overrun &= overrun - 1) {
+      links.rx_overruns[lowest_link(overrun)]++;
+    }
+    for (uint32_t bit = 0; bit < links.data_bits; bit++) {
+      links.rx_latched[bit] = (links.rx_latched[bit] & ~done) | (links.rx_data[bit] & done);
+    }
+    links.rx_latched_mask |= done;
+    return;
+  }
+
+  uint64_t planes[8] = {};
+  for (uint32_t bit = 0; bit < links.data_bits; bit++) {
+    planes[bit] = links.rx_data[links.data_bits - 1 - bit];
+  }
+  uint8_t bytes[bitslice_links];
+  planes_to_bytes(planes, bytes);
+  for (; done != 0; done &= done - 1) {
+    uint32_t link = lowest_link(done);
+    if (!links.rx_queue[link].push(bytes[link])) {
+      links.rx_overruns[link]++;
+    }
+  }
+}
+
+static void step_period(BITSLICE_LINKS &links, uint64_t noise, bool load) {
+  const uint32_t frame_bits = links.frame_bits;
+  const uint32_t data_bits = links.data_bits;
+
+  // Transmit: idle senders with a queued byte start a frame this period
+  uint64_t starting = links.tx_ready & ~links.tx_valid[0] & links.active;
+  if (load && starting != 0) {
+    load_queued_frames(links, starting);
+  }
+  uint64_t line = (links.tx_frame[0] | ~links.tx_valid[0]) ^ (noise & links.active);
+  uint64_t tx_done = links.tx_valid[0] & ~links.tx_valid[1];
+  for (uint32_t slot = 0; slot + 1 < frame_bits; slot++) {
+    links.tx_frame[slot] = links.tx_frame[slot + 1];
+    links.tx_valid[slot] = links.tx_valid[slot + 1];
+  }
+  links.tx_frame[frame_bits - 1] = 0;
+  links.tx_valid[frame_bits - 1] = 0;
+
+  // Receive: sample data slots, check stop slots
+  uint64_t busy = 0;
+  for (uint32_t slot = 1; slot < frame_bits; slot++) {
+    busy |= links.rx_next[slot];
+  }
+  for (uint32_t bit = 0; bit < data_bits; bit++) {
+    uint64_t sample = links.rx_next[1 + bit];
+    links.rx_data[bit] = (links.rx_data[bit] & ~sample) | (line & sample);
+  }
+  uint64_t bad_stop = 0;
+  for (uint32_t slot = data_bits + 1; slot < frame_bits; slot++) {
+    bad_stop |= links.rx_next[slot] & ~line;
+  }
+  uint64_t rx_done = links.rx_next[frame_bits - 1] & line;
+
+  for (uint32_t slot = frame_bits - 1; slot > 1; slot--) {
+    links.rx_next[slot] = links.rx_next[slot - 1] & ~bad_stop;
+  }
+  // Falling edge on an idle receiver is a start bit, a line that stays low
+  // after a bad stop bit is not
+  links.rx_next[1] = links.active & ~busy & links.line & ~line;
+  links.line = line;
+  links.periods++;
+
+  count_links(links.tx_count, tx_done);
+  count_links(links.rx_count, rx_done);
+  if (rx_done != 0) {
+    deliver_frames(links, rx_done);
+  }
+  // Per link bookkeeping only for errors
+  for (; bad_stop != 0; bad_stop &= bad_stop - 1) {
+    links.frame_errors[lowest_link(bad_stop)]++;
+  }
+}
+
+void bitslice_set_direct(BITSLICE_LINKS &links, bool direct) { links.direct = direct; }
+
+uint64_t bitslice_send(BITSLICE_LINKS &links, const uint8_t *bytes, uint64_t mask) {
+  mask &= links.active & ~links.tx_valid[0];
+  if (mask != 0) {
+    load_frames(links, bytes, mask);
+  }
+  return mask;
+}
+
+uint64_t bitslice_receive(BITSLICE_LINKS &links, uint8_t *bytes) {
+  uint64_t planes[8] = {};
+  for (uint32_t bit = 0; bit < links.data_bits; bit++) {
+    planes[bit] = links.rx_latched[links.data_bits - 1 - bit];
+  }
+  planes_to_bytes(planes, bytes);
+  uint64_t mask = links.rx_latched_mask;
+  links.rx_latched_mask = 0;
+  return mask;
+}
+
+uint32_t bitslice_tx_frames(const BITSLICE_LINKS &links, uint32_t link) { return read_count(links.tx_count, link); }
+
+uint32_t bitslice_rx_frames(const BITSLICE_LINKS &links, uint32_t link) { return read_count(links.rx_count, link); }
+
+void bitslice_step(BITSLICE_LINKS &links, uint64_t noise) { step_period(links, noise, true); }
+
+void bitslice_step_n(BITSLICE_LINKS &links, uint32_t periods) {
+  for (uint32_t i = 0; i < periods; i++) {
+    step_period(links, 0, true);
+  }
+}
+
+static bool line_busy(const BITSLICE_LINKS &links) {
+  uint64_t busy = links.tx_valid[0];
+  for (uint32_t slot = 1; slot < links.frame_bits; slot++) {
+    busy |= links.rx_next[slot];
+  }
+  return busy != 0;
+}
+
+bool bitslice_idle(const BITSLICE_LINKS &links) { return links.tx_ready == 0 && !line_busy(links); }
+
+bool bitslice_load(BITSLICE_LINKS &links, UART_DEVICE *const *senders, UART_DEVICE *const *receivers,
+                   uint32_t link_count) {
+  if (link_count == 0) {
+    return false;
+  }
+  const UART_CONFIG &config = senders[0]->config;
+  for (uint32_t link = 0; link < link_count; link++) {
+    const UART_DEVICE &sender = *senders[link];
+    const UART_DEVICE &receiver = *receivers[link];
+    if (sender.config.data_bits != config.data_bits || sender.config.stop_bits != config.stop_bits ||
+        receiver.config.data_bits != config.data_bits || receiver.config.stop_bits != config.stop_bits) {
+      return false;
+    }
+    if (sender.tx_serial_connection != &receiver.rx_buf || sender.bus_node != bus_no_node ||
+        receiver.bus_node != bus_no_node) {
+      return false;
+    }
+    // Frames already in rx_buf would be decoded after the bit-sliced ones
+    if (!receiver.rx_buf.is_empty()) {
+      return false;
+    }
+  }
+  if (!bitslice_init(links, link_count, config.data_bits, config.stop_bits)) {
+    return false;
+  }
+
+  for (uint32_t link = 0; link < link_count; link++) {
+    UART_DEVICE &sender = *senders[link];
+    // Whole characters only, a partial one stays behind in tx_buf
+    while (sender.tx_buf.count() >= links.data_bits && !links.tx_queue[link].is_full()) {
+      uint8_t value = 0;
+      for (uint32_t bit = 0; bit < links.data_bits; bit++) {
+        uint8_t line_bit = 0;
+        sender.tx_buf.pop(line_bit);
+        value = (uint8_t)((value << 1) | (line_bit & 0x01));
+      }
+      bitslice_push(links, link, value);
+    }
+    write_count(links.tx_count, link, sender.tx_frames);
+    write_count(links.rx_count, link, receivers[link]->rx_frames);
+    links.frame_errors[link] = receivers[link]->frame_errors;
+    links.rx_overruns[link] = receivers[link]->rx_overruns;
+  }
+  return true;
+}
+
+void bitslice_store(BITSLICE_LINKS &links, UART_DEVICE *const *senders, UART_DEVICE *const *receivers,
+                    uint32_t link_count) {
+  // Finish what is on the line without starting anything new
+  while (line_busy(links)) {
+    step_period(links, 0, false);
+  }
+  uint8_t latched[bitslice_links];
+  uint64_t latched_mask = bitslice_receive(links, latched);
+
+  for (uint32_t link = 0; link < link_count && link < bitslice_links; link++) {
+    UART_DEVICE &sender = *senders[link];
+    UART_DEVICE &receiver = *receivers[link];
+
+    // Unsent characters go back ahead of whatever load left in tx_buf:
+    // append them, then rotate the older bits round behind them
+    uint32_t left_behind = sender.tx_buf.count();
+    uint8_t value = 0;
+    while (links.tx_queue[link].pop(value)) {
+      for (int bit = (int)links.data_bits - 1; bit >= 0; --bit) {
+        sender.tx_buf.push((value >> bit) & 0x01);
+      }
+    }
+    for (uint32_t i = 0; i < left_behind; i++) {
+      uint8_t line_bit = 0;
+      sender.tx_buf.pop(line_bit);
+      sender.tx_buf.push(line_bit);
+    }
+    links.tx_ready &= ~(1ull << link);
+
+    // Direct mode leaves at most one byte per link latched, queued mode uses
+    // rx_queue
+    bool has_latched = (latched_mask >> link) & 1;
+    while (has_latched || links.rx_queue[link].pop(value)) {
+      if (has_latched) {
+        value = latched[link];
+        has_latched = false;
+      }
+      if (receiver.rx_fifo.count() >= receiver.rx_fifo_depth || !receiver.rx_fifo.push(value)) {
+        links.rx_overruns[link]++;
+      }
+    }
+
+    sender.tx_frames = read_count(links.tx_count, link);
+    receiver.rx_frames = read_count(links.rx_count, link);
+    receiver.frame_errors = links.frame_errors[link];
+    receiver.rx_overruns = links.rx_overruns[link];
+  }
+}
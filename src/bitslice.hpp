@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include "device.hpp"
+#include "ring_buffer.hpp"
+
+// Bit-sliced engine for fleets of identically configured point to point
+// links. Bit i of every word belongs to link i, so one pass of word wide
+// and/or/shift advances all 64 links by one bit period: transmit shift
+// registers, the line, falling edge start detection, data sampling and stop
+// bit checks. Frame bits are held as planes (one word per frame slot) and
+// bytes move in and out of the planes through 8x8 bit matrix transposes.
+//
+// Unlike service_device(), which moves a whole frame per call, this runs at
+// bit resolution: a receiver resyncs on the next falling edge after a bad
+// stop bit, as a real one would.
+constexpr uint32_t bitslice_links = 64;
+constexpr uint32_t bitslice_queue_capacity = 64;
+constexpr uint32_t bitslice_max_data_bits = 8;
+constexpr uint32_t bitslice_max_frame_bits = 1 + bitslice_max_data_bits + 2;
+constexpr uint32_t bitslice_counter_bits = 32;
+
+struct BITSLICE_LINKS {
+  // Word wide state, bit i is link i
+  uint64_t active = 0;                                   // Links in use
+  uint64_t tx_frame[bitslice_max_frame_bits] = {};       // Slot 0 goes on the line next
+  uint64_t tx_valid[bitslice_max_frame_bits] = {};       // Slot holds a frame bit
+  uint64_t tx_ready = 0;                                 // tx_queue not empty
+  uint64_t rx_next[bitslice_max_frame_bits] = {};        // One hot, slot the next line bit fills
+  uint64_t rx_data[bitslice_max_data_bits] = {};         // Sampled data planes, MSB first
+  uint64_t line = ~0ull;                                 // Last line level, idle high
+  uint64_t rx_latched[bitslice_max_data_bits] = {};      // Direct mode, completed data planes
+  uint64_t rx_latched_mask = 0;                          // Direct mode, links with a latched byte
+  uint64_t tx_count[bitslice_counter_bits] = {};         // Vertical counters, plane p is bit p of each
+  uint64_t rx_count[bitslice_counter_bits] = {};         // link's frame count
+  bool direct = false;                                   // Bytes stay in planes, queues unused
+
+  uint32_t data_bits = 8;
+  uint32_t stop_bits = 1;
+  uint32_t frame_bits = 10;
+  uint64_t periods = 0;
+
+  // Per link, touched once per frame in queued mode and only on errors in
+  // direct mode
+  ring_buffer<uint8_t, bitslice_queue_capacity> tx_queue[bitslice_links];
+  ring_buffer<uint8_t, bitslice_queue_capacity> rx_queue[bitslice_links];
+  uint32_t frame_errors[bitslice_links] = {};
+  uint32_t rx_overruns[bitslice_links] = {};
+};
+
+// Clears all state, data_bits 1-8 and stop_bits 1-2
+bool bitslice_init(BITSLICE_LINKS &links, uint32_t link_count, uint32_t data_bits, uint32_t stop_bits);
+
+// Queued mode, bytes go through a small queue per link. Push refuses links
+// past the link_count given to bitslice_init() and full queues.
+bool bitslice_push(BITSLICE_LINKS &links, uint32_t link, uint8_t value);
+bool bitslice_pop(BITSLICE_LINKS &links, uint32_t link, uint8_t &value);
+
+// Direct mode for fleets driven in lockstep, bytes never leave word form
+// except through one transpose per call. Send starts a frame on every idle
+// link in mask and returns the links that started. Receive hands out the
+// bytes completed since the last call, one per link in the returned mask; a
+// link completing again before that is an overrun.
+void bitslice_set_direct(BITSLICE_LINKS &links, bool direct);
+uint64_t bitslice_send(BITSLICE_LINKS &links, const uint8_t *bytes, uint64_t mask);
+uint64_t bitslice_receive(BITSLICE_LINKS &links, uint8_t *bytes);
+
+[[nodiscard]] uint32_t bitslice_tx_frames(const BITSLICE_LINKS &links, uint32_t link);
+[[nodiscard]] uint32_t bitslice_rx_frames(const BITSLICE_LINKS &links, uint32_t link);
+
+// One bit period on every link. noise is xored onto the line, bit i flips
+// what link i's receiver sees.
+void bitslice_step(BITSLICE_LINKS &links, uint64_t noise = 0);
+void bitslice_step_n(BITSLICE_LINKS &links, uint32_t periods);
+
+// No frame on any line and nothing queued to send
+[[nodiscard]] bool bitslice_idle(const BITSLICE_LINKS &links);
+
+// Link i carries senders[i] -> receivers[i]. Load takes whole characters
+// from each sender's tx_buf and the frame counters from both ends; all
+// devices must share data_bits and stop_bits, each pair must be wired with
+// serial_connection() rather than a bus, and each receiver's rx_buf must be
+// empty so no older frame is left to decode behind the newer ones.
+bool bitslice_load(BITSLICE_LINKS &links, UART_DEVICE *const *senders, UART_DEVICE *const *receivers,
+                   uint32_t link_count);
+
+// Runs frames already on the line to their stop bit, then hands unsent
+// characters back to the front of each sender's tx_buf, received bytes to
+// each receiver's rx_fifo and the counters to both ends.
+void bitslice_store(BITSLICE_LINKS &links, UART_DEVICE *const *senders, UART_DEVICE *const *receivers,
+                    uint32_t link_count);
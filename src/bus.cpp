@@ -0,0 +1,134 @@
+#include "bus.hpp"
+#include "device.hpp"
+
+constexpr uint8_t start_bit = 0x00; // low line
+constexpr uint8_t stop_bit = 0x01; // high line
+constexpr uint32_t bus_mask = bus_capacity - 1;
+
+bool serial_bus(UART_BUS &bus, UART_DEVICE &dev) {
+  for (uint8_t node = 0; node < bus_max_nodes; node++) {
+    if ((bus.attached_mask & (1ull << node)) == 0) {
+      bus.attached_mask |= 1ull << node;
+      bus.read_seq[node] = bus.write_seq; // Late joiners only see new traffic
+      dev.bus = &bus;
+      dev.bus_node = node;
+      return true;
+    }
+  }
+  return false;
+}
+
+void detach_bus(UART_BUS &bus, UART_DEVICE &dev) {
+  if (dev.bus != &bus) {
+    return;
+  }
+  bus.attached_mask &= ~(1ull << dev.bus_node);
+  bus.driver_mask &= ~(1ull << dev.bus_node);
+  dev.bus = nullptr;
+  dev.bus_node = bus_no_node;
+}
+
+bool bus_enable_driver(UART_BUS &bus, uint8_t node) {
+  uint64_t node_bit = 1ull << node;
+  bool contended = (bus.driver_mask & ~node_bit) != 0;
+  bus.driver_mask |= node_bit;
+  if (contended) {
+    bus.collisions++;
+    return false;
+  }
+  return true;
+}
+
+void bus_disable_driver(UART_BUS &bus, uint8_t node) { bus.driver_mask &= ~(1ull << node); }
+
+bool bus_send_bit(UART_BUS &bus, uint8_t node, const uint8_t value) {
+  uint64_t node_bit = 1ull << node;
+  if ((bus.driver_mask & node_bit) == 0) {
+    // Driver disabled, nothing reaches the line
+    return false;
+  }
+
+  uint8_t slot = (uint8_t)((node << 1) | (value & bus_slot_level));
+  bool collided = (bus.driver_mask & (bus.driver_mask - 1)) != 0;
+  if (collided) {
+    // More than one driver, the readback no longer matches what we drove
+    slot |= bus_slot_collision;
+    bus.collisions++;
+  }
+
+  bus.line[bus.write_seq & bus_mask] = slot;
+  bus.write_seq++;
+  return !collided;
+}
+
+uint32_t bus_pending(const UART_BUS &bus, uint8_t node) { return bus.write_seq - bus.read_seq[node]; }
+
+void bus_flush(UART_BUS &bus, uint8_t node) { bus.read_seq[node] = bus.write_seq; }
+
+// Find the next slot driven by another node, skipping our own echo
+static bool next_slot(UART_BUS &bus, uint8_t node, uint8_t &slot) {
+  uint32_t &cursor = bus.read_seq[node];
+  if (bus.write_seq - cursor > bus_capacity) {
+    // Reader fell a full ring behind, oldest bits are gone
+    cursor = bus.write_seq - bus_capacity;
+    bus.overruns++;
+  }
+  while (cursor != bus.write_seq) {
+    slot = bus.line[cursor & bus_mask];
+    if (((slot >> 1) & 0x3F) != node) {
+      return true;
+    }
+    cursor++;
+  }
+  return false;
+}
+
+static bool pop_level(UART_BUS &bus, uint8_t node, uint8_t &level) {
+  uint8_t slot = 0;
+  if (!next_slot(bus, node, slot) || (slot & bus_slot_collision)) {
+    return false;
+  }
+  level = slot & bus_slot_level;
+  bus.read_seq[node]++;
+  return true;
+}
+
+bool bus_receive_frame(UART_BUS &bus, UART_DEVICE &dev, uint8_t &reconstructed_character) {
+  uint8_t node = dev.bus_node;
+  reconstructed_character = 0x00;
+
+  uint8_t message_start = 0;
+  if (!pop_level(bus, node, message_start)) {
+    if (bus_pending(bus, node) != 0) {
+      // Collision garbage at the head of the line
+      bus_flush(bus, node);
+      dev.frame_errors++;
+    }
+    return false;
+  }
+  if (message_start != start_bit) {
+    // Invalid start bit - skip this frame
+    bus_flush(bus, node);
+    dev.frame_errors++;
+    return false;
+  }
+
+  for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
+    uint8_t message_data_value = 0;
+    if (!pop_level(bus, node, message_data_value)) {
+      bus_flush(bus, node);
+      dev.frame_errors++;
+      return false;
+    }
+    reconstructed_character = (reconstructed_character << 1) | message_data_value;
+  }
+
+  uint8_t message_end = 0;
+  if (!pop_level(bus, node, message_end) || message_end != stop_bit) {
+    // Bad frame
+    bus_flush(bus, node);
+    dev.frame_errors++;
+    return false;
+  }
+  return true;
+}
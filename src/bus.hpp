@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct UART_DEVICE;
+
+// Multi-drop (RS-485 style) line. The driving node writes each line bit once
+// into a shared ring and every attached node reads it through its own cursor,
+// so fan-out costs one store per bit regardless of how many nodes listen.
+constexpr uint32_t bus_capacity = 1024;
+constexpr uint32_t bus_max_nodes = 64;
+constexpr uint8_t bus_no_node = 0xFF;
+constexpr uint32_t cache_line_size = 64;
+
+static_assert((bus_capacity & (bus_capacity - 1)) == 0, "bus_capacity must be a power of two.");
+
+// Line slot layout: bit 0 is the line level, bits 1-6 the driving node (so a
+// node can skip its own echo) and bit 7 marks a slot garbled by a collision.
+constexpr uint8_t bus_slot_level = 0x01;
+constexpr uint8_t bus_slot_collision = 0x80;
+
+// The driving node and the listeners write different fields, so the writer
+// state, the reader cursors and the line itself each start a cache line.
+struct UART_BUS {
+  // Writer side
+  alignas(cache_line_size) uint32_t write_seq = 0;  // Free running, index with & (bus_capacity - 1)
+  uint32_t collisions = 0;
+  uint64_t driver_mask = 0;                         // Nodes with driver enable asserted
+
+  // Reader side
+  alignas(cache_line_size) uint32_t read_seq[bus_max_nodes] = {};  // One cursor per attached node
+  uint64_t attached_mask = 0;
+  uint32_t overruns = 0;
+
+  alignas(cache_line_size) uint8_t line[bus_capacity] = {};
+};
+
+static_assert(offsetof(UART_BUS, read_seq) % cache_line_size == 0, "Reader cursors must start a cache line.");
+static_assert(offsetof(UART_BUS, read_seq) >= offsetof(UART_BUS, driver_mask) + sizeof(uint64_t),
+              "Writer state must not share a line with the cursors.");
+
+// Attach a device as the next free node, returns false when the bus is full
+bool serial_bus(UART_BUS &bus, UART_DEVICE &dev);
+void detach_bus(UART_BUS &bus, UART_DEVICE &dev);
+
+// Driver enable, asserting while another node drives counts a collision
+bool bus_enable_driver(UART_BUS &bus, uint8_t node);
+void bus_disable_driver(UART_BUS &bus, uint8_t node);
+
+bool bus_send_bit(UART_BUS &bus, uint8_t node, const uint8_t value);
+[[nodiscard]] uint32_t bus_pending(const UART_BUS &bus, uint8_t node);
+void bus_flush(UART_BUS &bus, uint8_t node);
+
+// Decode one frame from the node's cursor, bad frames flush the cursor
+bool bus_receive_frame(UART_BUS &bus, UART_DEVICE &dev, uint8_t &reconstructed_character);
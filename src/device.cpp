@@ -1,6 +1,19 @@
 #include "device.hpp"
+#include "latency.hpp"
+#include "trace.hpp"
 
-constexpr double time_step = 0.0001;
+constexpr uint8_t start_bit = 0x00; // low line
+constexpr uint8_t stop_bit = 0x01; // high line
+
+// Trace span names, indexed by DeviceState
+[[maybe_unused]] static const char *const state_names[] = {"IDLE", "TRANSMITTING", "RECEIVING",
+                                                           "RECEIVING_AND_TRANSMITTING"};
+
+void attach_buffers(UART_DEVICE &dev, uint8_t *tx_storage, uint32_t tx_capacity, uint8_t *rx_storage,
+                    uint32_t rx_capacity) {
+  dev.tx_buf.attach(tx_storage, tx_capacity);
+  dev.rx_buf.attach(rx_storage, rx_capacity);
+}
 
 uint8_t read_rx_buf(UART_DEVICE &dev) {
   uint8_t read_value = 0x00;
@@ -13,14 +26,45 @@ uint8_t read_rx_buf(UART_DEVICE &dev) {
 
 bool push_tx_buf(UART_DEVICE &dev, uint8_t value) {
   if (dev.tx_buf.push(value)) {
+    if (dev.latency != nullptr) {
+      latency_tx_bits(dev, 1);
+    }
     return 0;
   } else {
     return 1;
   }
 }
 
+bool push_tx_byte(UART_DEVICE &dev, const uint8_t character) {
+  uint32_t data_size = dev.config.data_bits;
+  if (dev.tx_buf.capacity() - dev.tx_buf.count() < data_size) {
+    return false;
+  }
+  for (int32_t i = (int32_t)data_size - 1; i >= 0; --i) {
+    dev.tx_buf.push((character >> i) & 0x01);
+  }
+  if (dev.latency != nullptr) {
+    latency_tx_bits(dev, data_size);
+  }
+  return true;
+}
+
+uint32_t load_bit_array_tx(UART_DEVICE &dev, const uint8_t *bit_arr, uint32_t size) {
+  uint32_t loaded = 0;
+  while (loaded < size && dev.tx_buf.push(bit_arr[loaded])) {
+    loaded++;
+  }
+  if (dev.latency != nullptr) {
+    latency_tx_bits(dev, loaded);
+  }
+  return loaded;
+}
+
 // Some bits get lost but we can recover partial data
 bool send_bit(UART_DEVICE &dev, const uint8_t value) {
+  if (dev.bus_node != bus_no_node) {
+    return bus_send_bit(*dev.bus, dev.bus_node, value);
+  }
   if (dev.tx_serial_connection != nullptr && dev.tx_serial_connection->push(value)) {
     return true;
   } else {
@@ -31,10 +75,19 @@ bool send_bit(UART_DEVICE &dev, const uint8_t value) {
 void serial_connection(UART_DEVICE &dev, UART_DEVICE &other) {
   dev.tx_serial_connection = &other.rx_buf;
   other.tx_serial_connection = &dev.rx_buf;
+  if (dev.latency != nullptr) {
+    dev.latency->peer = other.latency;
+  }
+  if (other.latency != nullptr) {
+    other.latency->peer = dev.latency;
+  }
   // Simulate direct wiring
 }
 
-void tick_down(UART_DEVICE &dev) { dev.clock -= time_step; }
+void tick_down(UART_DEVICE &dev) {
+  dev.clock -= time_step;
+  dev.ticks++;
+}
 
 void reset_clock(UART_DEVICE &dev) { dev.clock = dev.time_per_byte; }
 
@@ -45,4 +98,214 @@ bool is_ready(UART_DEVICE &dev) {
   else {
     return false;
   }
-}
\ No newline at end of file
+}
+
+void set_event_handler(UART_DEVICE &dev, uint8_t event_mask, uart_event_handler handler, void *ctx) {
+  dev.event_handler = handler;
+  dev.event_ctx = ctx;
+  dev.event_mask = event_mask;
+}
+
+void set_rx_threshold(UART_DEVICE &dev, uint32_t threshold) {
+  if (threshold == 0) {
+    threshold = 1;
+  }
+  if (threshold > rx_fifo_capacity) {
+    threshold = rx_fifo_capacity;
+  }
+  dev.rx_threshold = threshold;
+}
+
+static void raise_event(UART_DEVICE &dev, UartEvent event) {
+  if (dev.event_handler != nullptr && (dev.event_mask & (uint8_t)event) != 0) {
+    dev.event_handler(dev, event, dev.event_ctx);
+  }
+}
+
+static bool rx_line_pending(const UART_DEVICE &dev) {
+  if (dev.bus_node != bus_no_node) {
+    return bus_pending(*dev.bus, dev.bus_node) != 0;
+  }
+  return !dev.rx_buf.is_empty();
+}
+
+// Next state from the current one and what is pending, indexed by
+// state * 4 + rx_pending * 2 + tx_pending. Same results as the if chain it
+// replaces, including a busy state narrowing to the side still pending.
+static constexpr DeviceState transition_table[16] = {
+    // IDLE
+    DeviceState::IDLE, DeviceState::TRANSMITTING, DeviceState::RECEIVING, DeviceState::RECEIVING_AND_TRANSMITTING,
+    // TRANSMITTING
+    DeviceState::TRANSMITTING, DeviceState::TRANSMITTING, DeviceState::RECEIVING_AND_TRANSMITTING,
+    DeviceState::TRANSMITTING,
+    // RECEIVING
+    DeviceState::RECEIVING, DeviceState::RECEIVING_AND_TRANSMITTING, DeviceState::RECEIVING,
+    DeviceState::RECEIVING_AND_TRANSMITTING,
+    // RECEIVING_AND_TRANSMITTING
+    DeviceState::RECEIVING_AND_TRANSMITTING, DeviceState::TRANSMITTING, DeviceState::RECEIVING,
+    DeviceState::RECEIVING_AND_TRANSMITTING,
+};
+
+// DeviceState values double as a tx bit and an rx bit
+constexpr uint8_t state_tx_bit = 0x01;
+constexpr uint8_t state_rx_bit = 0x02;
+static_assert((uint8_t)DeviceState::TRANSMITTING == state_tx_bit && (uint8_t)DeviceState::RECEIVING == state_rx_bit &&
+                  (uint8_t)DeviceState::RECEIVING_AND_TRANSMITTING == (state_tx_bit | state_rx_bit),
+              "DeviceState must stay bit encoded.");
+
+static void transition_uart_state(UART_DEVICE &dev) {
+  uint32_t index = (uint32_t)dev.state * 4 + (uint32_t)rx_line_pending(dev) * 2 + (uint32_t)!dev.tx_buf.is_empty();
+  dev.state = transition_table[index];
+
+  if (dev.state != DeviceState::IDLE) {
+    UART_TRACE_BEGIN(&dev, state_names[(uint8_t)dev.state], 0);
+  }
+}
+
+// Decode one frame of line bits from rx_buf, bad frames flush the line
+static bool decode_rx_buf(UART_DEVICE &dev, uint8_t &reconstructed_character) {
+  reconstructed_character = 0x00;
+
+  uint8_t message_start = 0;
+  if (!dev.rx_buf.peek(message_start)) {
+    return false;
+  }
+  if (message_start != start_bit) {
+    // Invalid start bit - skip this frame
+    dev.rx_buf.reset();
+    dev.frame_errors++;
+    return false;
+  }
+  dev.rx_buf.pop(message_start);
+
+  for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
+    uint8_t message_data_value = 0;
+    if (!dev.rx_buf.pop(message_data_value)) {
+      // Buffer underrun - invalid frame
+      dev.rx_buf.reset();
+      dev.frame_errors++;
+      return false;
+    }
+    reconstructed_character = (reconstructed_character << 1) | message_data_value;
+  }
+
+  uint8_t message_end = 0;
+  if (dev.rx_buf.peek(message_end) && message_end == stop_bit) {
+    dev.rx_buf.pop(message_end);
+    return true;
+  }
+  // Bad frame
+  dev.rx_buf.reset();
+  dev.frame_errors++;
+  return false;
+}
+
+bool transmit_frame(UART_DEVICE &dev) {
+  if (dev.tx_buf.count() < dev.config.data_bits) {
+    // Not a whole character queued yet
+    return false;
+  }
+  UART_TRACE_BEGIN(&dev, "tx frame", dev.tx_frames);
+
+  uint32_t sent_bits = send_bit(dev, start_bit);
+  for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
+    uint8_t send_value = 0;
+    dev.tx_buf.pop(send_value);
+    sent_bits += send_bit(dev, send_value);
+  }
+  sent_bits += send_bit(dev, stop_bit);
+  dev.dropped_bits += dev.config.data_bits + 2 - sent_bits;
+  dev.tx_frames++;
+  UART_TRACE_END(&dev, "tx frame", sent_bits);
+  if (dev.latency != nullptr) {
+    latency_tx_frame(dev, sent_bits == dev.config.data_bits + 2);
+  }
+
+  if (dev.tx_buf.is_empty()) {
+    raise_event(dev, UartEvent::TX_EMPTY);
+  }
+  return true;
+}
+
+bool receive_frame(UART_DEVICE &dev) {
+  uint32_t frame_errors = dev.frame_errors;
+  uint8_t reconstructed_character = 0x00;
+  UART_TRACE_BEGIN(&dev, "rx frame", dev.rx_frames);
+  bool decoded = dev.bus_node != bus_no_node ? bus_receive_frame(*dev.bus, dev, reconstructed_character)
+                                    : decode_rx_buf(dev, reconstructed_character);
+  UART_TRACE_END(&dev, "rx frame", reconstructed_character);
+  if (!decoded) {
+    if (dev.latency != nullptr) {
+      latency_rx_frame(dev, false, false);
+    }
+    if (dev.frame_errors != frame_errors) {
+      UART_TRACE_INSTANT(&dev, "frame error", dev.frame_errors);
+      raise_event(dev, UartEvent::FRAME_ERROR);
+    }
+    return false;
+  }
+  dev.rx_frames++;
+
+  if (dev.rx_fifo.count() >= dev.rx_fifo_depth || !dev.rx_fifo.push(reconstructed_character)) {
+    dev.rx_overruns++;
+    if (dev.latency != nullptr) {
+      latency_rx_frame(dev, true, false);
+    }
+    UART_TRACE_INSTANT(&dev, "overrun", dev.rx_overruns);
+    raise_event(dev, UartEvent::OVERRUN_ERROR);
+    return false;
+  }
+
+  if (dev.latency != nullptr) {
+    latency_rx_frame(dev, true, true);
+  }
+
+  // Edge triggered so a slow consumer sees one threshold event per batch
+  bool threshold_crossed = dev.rx_fifo.count() == dev.rx_threshold;
+  raise_event(dev, UartEvent::RX_READY);
+  if (threshold_crossed) {
+    raise_event(dev, UartEvent::RX_THRESHOLD);
+  }
+  return true;
+}
+
+void service_device(UART_DEVICE &dev) {
+  if (!is_ready(dev)) {
+    return;
+  }
+  reset_clock(dev);
+  transition_uart_state(dev);
+
+  DeviceState state = dev.state;
+  if ((uint8_t)state & state_tx_bit) {
+    transmit_frame(dev);
+  }
+  if ((uint8_t)state & state_rx_bit) {
+    receive_frame(dev);
+  }
+  if (state != DeviceState::IDLE) {
+    UART_TRACE_END(&dev, state_names[(uint8_t)state], 0);
+  }
+  dev.state = DeviceState::IDLE;
+}
+
+void step_device(UART_DEVICE &dev) {
+  service_device(dev);
+  tick_down(dev);
+}
+
+void step_n(UART_DEVICE *const *devices, uint32_t device_count, uint32_t ticks) {
+  for (uint32_t tick = 0; tick < ticks; tick++) {
+    for (uint32_t i = 0; i < device_count; i++) {
+      step_device(*devices[i]);
+    }
+  }
+}
+
+uint32_t read_rx_fifo(UART_DEVICE &dev, uint8_t *out, uint32_t max_count) {
+  uint32_t read_count = 0;
+  while (read_count < max_count && dev.rx_fifo.pop(out[read_count])) {
+    read_count++;
+  }
+  return read_count;
+}
@@ -1,8 +1,14 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include "ring_buffer.hpp"
+#include "ext_ring_buffer.hpp"
+#include "bus.hpp"
 
+constexpr uint32_t buf_capacity_small = 64;
 constexpr uint32_t buf_capacity_large = 512;
+constexpr uint32_t rx_fifo_capacity = 64;
+constexpr double time_step = 0.0001; // Simulated seconds per tick_down()
 
 enum class DeviceState : uint8_t {
   IDLE,
@@ -11,21 +17,26 @@ enum class DeviceState : uint8_t {
   RECEIVING_AND_TRANSMITTING,
 };
 
+// Event sources, also used as bits in UART_DEVICE::event_mask
+enum class UartEvent : uint8_t {
+  RX_READY = 0x01,      // A byte was decoded into rx_fifo
+  RX_THRESHOLD = 0x02,  // rx_fifo reached rx_threshold bytes
+  TX_EMPTY = 0x04,      // tx_buf drained after a frame went out
+  FRAME_ERROR = 0x08,   // Bad start or stop bit, frame discarded
+  OVERRUN_ERROR = 0x10, // rx_fifo full, decoded byte dropped
+};
+
+constexpr uint8_t uart_events_all = 0x1F;
+constexpr uint8_t uart_events_errors = 0x18;
+
+struct UART_DEVICE;
+struct UART_LATENCY;
+using uart_event_handler = void (*)(UART_DEVICE &dev, UartEvent event, void *ctx);
+
 // enum class Endianness : uint8_t {
 //   BIG,
 //   LITTLE,
 // };
-// // Need to think about size of registers
-// enum class Registers : uint32_t {
-//   D0,
-//   D1,
-//   D2,
-//   D3,
-//   D4,
-//   D5,
-//   D6,
-//   D7,
-// };
 
 struct UART_CONFIG {
     uint32_t baud_rate;
@@ -37,16 +48,39 @@ struct UART_CONFIG {
 
 // Maybe let's treat each byte as a single bit of info? Send only
 
-struct UART_DEVICE {
+// Field order is deliberate: everything tick_down, is_ready and a frame's
+// transmit/receive touch sits in the first cache line, line settings and event
+// plumbing in the next, and the decoded byte FIFO after that. Line bit storage
+// lives outside the device entirely (attach_buffers).
+struct alignas(64) UART_DEVICE {
+  // Hot
+  double clock = 0.0;           // Initialize to 0
+  ext_ring_buffer<uint8_t>* tx_serial_connection = nullptr;
+  ext_ring_buffer<uint8_t> tx_buf = {};
   DeviceState state = DeviceState::IDLE;
+  uint8_t bus_node = bus_no_node;   // Set when wired to a multi-drop bus instead of a peer
+  uint8_t event_mask = 0;
+  ext_ring_buffer<uint8_t> rx_buf = {};
+  uint32_t ticks = 0;           // tick_down() count, wraps, latency tags are relative to it
 
-  ring_buffer<uint8_t, buf_capacity_large> tx_buf = {};
-  ring_buffer<uint8_t, buf_capacity_large> rx_buf = {};
-  ring_buffer<uint8_t, buf_capacity_large>* tx_serial_connection = nullptr;
+  // Warm, read once per frame
+  double time_per_byte = 0.0;   // Initialize to 0
+  UART_BUS* bus = nullptr;
   UART_CONFIG config;
   uint32_t bits_per_frame = 0;  // Initialize to 0
-  double time_per_byte = 0.0;   // Initialize to 0
-  double clock = 0.0;           // Initialize to 0
+  uint32_t rx_threshold = 1;
+  uint32_t rx_fifo_depth = rx_fifo_capacity;  // Usable part of rx_fifo, beyond it is an overrun
+  uart_event_handler event_handler = nullptr;
+  void* event_ctx = nullptr;
+  uint32_t frame_errors = 0;
+  uint32_t rx_overruns = 0;
+  uint32_t tx_frames = 0;
+  uint32_t rx_frames = 0;       // Decoded off the line, overruns included
+  uint32_t dropped_bits = 0;    // Line bits that found no room at the receiver
+  UART_LATENCY* latency = nullptr;  // Optional per byte latency tracking, see enable_latency()
+
+  // Decoded bytes, see service_device()
+  ring_buffer<uint8_t, rx_fifo_capacity> rx_fifo = {};
 
   // Add a function to calculate these values
   void calculate_timing() {
@@ -56,13 +90,58 @@ struct UART_DEVICE {
   }
 };
 
+static_assert(sizeof(ext_ring_buffer<uint8_t>) == 20, "ext_ring_buffer header must stay packed.");
+static_assert(offsetof(UART_DEVICE, clock) < cache_line_size, "clock must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, tx_serial_connection) < cache_line_size, "Peer must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, tx_buf) + sizeof(ext_ring_buffer<uint8_t>) <= cache_line_size,
+              "tx_buf indices must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, rx_buf) + sizeof(ext_ring_buffer<uint8_t>) <= cache_line_size,
+              "rx_buf indices must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, ticks) < cache_line_size, "ticks must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, state) < cache_line_size && offsetof(UART_DEVICE, bus_node) < cache_line_size,
+              "state and bus_node must be in the hot line.");
+static_assert(offsetof(UART_DEVICE, tx_buf) % 8 == 0 && offsetof(UART_DEVICE, rx_buf) % 8 == 0,
+              "Ring storage pointers should stay naturally aligned.");
+static_assert(offsetof(UART_DEVICE, time_per_byte) == cache_line_size, "Warm fields start on the second line.");
+static_assert(offsetof(UART_DEVICE, bus) < 2 * cache_line_size, "Bus pointer must be in the warm line.");
+static_assert(offsetof(UART_DEVICE, rx_fifo) >= cache_line_size, "rx_fifo must not share the hot line.");
+
+// Storage must outlive the device. A capacity that is not a power of two is
+// rounded down to one, so 1000 bytes of storage holds 512 bits.
+void attach_buffers(UART_DEVICE &dev, uint8_t *tx_storage, uint32_t tx_capacity, uint8_t *rx_storage,
+                    uint32_t rx_capacity);
+
+template <uint32_t TxN, uint32_t RxN>
+void attach_buffers(UART_DEVICE &dev, uint8_t (&tx_storage)[TxN], uint8_t (&rx_storage)[RxN]) {
+  static_assert((TxN & (TxN - 1)) == 0 && (RxN & (RxN - 1)) == 0, "UART buffer sizes must be powers of two.");
+  attach_buffers(dev, tx_storage, TxN, rx_storage, RxN);
+}
+
 uint8_t read_rx_buf(UART_DEVICE &dev); // when it receives a 0 we start counting
                                        // then back to IDLE , if the line isn't
                                        // high after count the invalid frame
 // If frame invalid discard and reset
 bool push_tx_buf(UART_DEVICE &dev, const uint8_t value);
+bool push_tx_byte(UART_DEVICE &dev, const uint8_t character); // MSB first, config.data_bits wide
+uint32_t load_bit_array_tx(UART_DEVICE &dev, const uint8_t *bit_arr, uint32_t size); // Raw line bits, returns how many fit
 bool send_bit(UART_DEVICE &dev, const uint8_t value);
 void serial_connection(UART_DEVICE &dev, UART_DEVICE &other);
 void tick_down(UART_DEVICE &dev);
 void reset_clock(UART_DEVICE &dev);
-bool is_ready(UART_DEVICE &dev);
\ No newline at end of file
+bool is_ready(UART_DEVICE &dev);
+
+// Event driven servicing: handlers fire from inside service_device() as
+// receive_frame() completes frames, so callers need not poll read_rx_fifo()
+// for output.
+void set_event_handler(UART_DEVICE &dev, uint8_t event_mask, uart_event_handler handler, void *ctx);
+void set_rx_threshold(UART_DEVICE &dev, uint32_t threshold);
+bool transmit_frame(UART_DEVICE &dev);
+bool receive_frame(UART_DEVICE &dev);
+void service_device(UART_DEVICE &dev);
+uint32_t read_rx_fifo(UART_DEVICE &dev, uint8_t *out, uint32_t max_count);
+
+// The engine entry points every front end drives: one tick of one device
+// (service_device() then tick_down()), and ticks of a whole set with the
+// devices interleaved in array order on every tick.
+void step_device(UART_DEVICE &dev);
+void step_n(UART_DEVICE *const *devices, uint32_t device_count, uint32_t ticks);
@@ -0,0 +1,57 @@
+#pragma once
+#include "stdint.h"
+
+// ring_buffer over caller provided storage with a power of two capacity picked
+// at runtime. head and tail run freely and are masked on access, so the live
+// count is head - tail and no separate size is kept. A buffer without storage
+// has capacity 0 and rejects every push.
+//
+// Packed to 4 bytes so the header is 20 bytes, which lets a device keep both
+// of its rings plus clock, state and peer in a single cache line.
+#pragma pack(push, 4)
+template <typename T>
+class ext_ring_buffer {
+private:
+    T* buffer;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t cap;
+
+public:
+    ext_ring_buffer() noexcept;
+    ext_ring_buffer(T* storage, uint32_t capacity) noexcept;
+    ~ext_ring_buffer() noexcept;
+
+    // There is no storage to copy into on construction, only assignment copies
+    ext_ring_buffer(const ext_ring_buffer& other) = delete;
+    ext_ring_buffer& operator=(const ext_ring_buffer& other) noexcept;
+
+    ext_ring_buffer(ext_ring_buffer&& other) noexcept;
+    ext_ring_buffer& operator=(ext_ring_buffer&& other) noexcept;
+
+    // Capacity is rounded down to a power of two, contents are dropped
+    void attach(T* storage, uint32_t capacity) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] bool is_empty() const noexcept;
+    [[nodiscard]] bool is_full()  const noexcept;
+    [[nodiscard]] uint32_t count() const noexcept;
+    [[nodiscard]] uint32_t capacity() const noexcept;
+    [[nodiscard]] T* storage() const noexcept;
+    [[nodiscard]] uint32_t front_index() const noexcept; // Free running tail, mask with capacity - 1
+    [[nodiscard]] uint32_t back_index() const noexcept;  // Free running head
+
+    // Snapshot restore, storage is filled by the caller. Fails if more than
+    // capacity would be live.
+    bool set_indices(uint32_t head_index, uint32_t tail_index) noexcept;
+
+    // In place consumers work on storage() directly and then drop what they used
+    void discard(uint32_t count) noexcept;
+
+    bool push(const T& value) noexcept;
+    bool pop(T& value) noexcept;
+    bool peek(T& value) const noexcept;
+};
+#pragma pack(pop)
+
+#include "ext_ring_buffer.tpp"
@@ -0,0 +1,154 @@
+static inline uint32_t floor_power_of_two(uint32_t value) {
+    while ((value & (value - 1)) != 0) {
+        value &= value - 1;
+    }
+    return value;
+}
+
+template <typename T>
+ext_ring_buffer<T>::ext_ring_buffer() noexcept : buffer(nullptr), head(0), tail(0), cap(0) {}
+
+template <typename T>
+ext_ring_buffer<T>::ext_ring_buffer(T* storage, uint32_t capacity) noexcept
+    : buffer(storage), head(0), tail(0), cap(storage != nullptr ? floor_power_of_two(capacity) : 0) {}
+
+template <typename T>
+ext_ring_buffer<T>::~ext_ring_buffer() noexcept {}
+
+// Copies only the live slots, oldest first, as many as our storage holds
+template <typename T>
+ext_ring_buffer<T>& ext_ring_buffer<T>::operator=(const ext_ring_buffer& other) noexcept {
+    if (this != &other) {
+        uint32_t live = other.count();
+        if (live > cap) {
+            live = cap;
+        }
+        for (uint32_t i = 0; i < live; ++i) {
+            buffer[i] = other.buffer[(other.tail + i) & (other.cap - 1)];
+        }
+        head = live;
+        tail = 0;
+    }
+    return *this;
+}
+
+// Moves swap the storage pointer, nothing is copied
+template <typename T>
+ext_ring_buffer<T>::ext_ring_buffer(ext_ring_buffer&& other) noexcept
+    : buffer(other.buffer), head(other.head), tail(other.tail), cap(other.cap) {
+    other.buffer = nullptr;
+    other.head = 0;
+    other.tail = 0;
+    other.cap = 0;
+}
+
+template <typename T>
+ext_ring_buffer<T>& ext_ring_buffer<T>::operator=(ext_ring_buffer&& other) noexcept {
+    if (this != &other) {
+        T* other_buffer = other.buffer;
+        uint32_t other_head = other.head;
+        uint32_t other_tail = other.tail;
+        uint32_t other_cap = other.cap;
+        other.buffer = buffer;
+        other.head = head;
+        other.tail = tail;
+        other.cap = cap;
+        buffer = other_buffer;
+        head = other_head;
+        tail = other_tail;
+        cap = other_cap;
+    }
+    return *this;
+}
+
+template <typename T>
+void ext_ring_buffer<T>::attach(T* storage, uint32_t capacity) noexcept {
+    buffer = storage;
+    cap = storage != nullptr ? floor_power_of_two(capacity) : 0;
+    head = 0;
+    tail = 0;
+}
+
+template <typename T>
+void ext_ring_buffer<T>::reset() noexcept {
+    head = 0;
+    tail = 0;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::is_empty() const noexcept {
+    return head == tail;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::is_full() const noexcept {
+    return head - tail == cap;
+}
+
+template <typename T>
+uint32_t ext_ring_buffer<T>::count() const noexcept {
+    return head - tail;
+}
+
+template <typename T>
+uint32_t ext_ring_buffer<T>::capacity() const noexcept {
+    return cap;
+}
+
+template <typename T>
+T* ext_ring_buffer<T>::storage() const noexcept {
+    return buffer;
+}
+
+template <typename T>
+uint32_t ext_ring_buffer<T>::front_index() const noexcept {
+    return tail;
+}
+
+template <typename T>
+uint32_t ext_ring_buffer<T>::back_index() const noexcept {
+    return head;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::set_indices(uint32_t head_index, uint32_t tail_index) noexcept {
+    if (head_index - tail_index > cap) {
+        return false;
+    }
+    head = head_index;
+    tail = tail_index;
+    return true;
+}
+
+template <typename T>
+void ext_ring_buffer<T>::discard(uint32_t count) noexcept {
+    uint32_t live = head - tail;
+    tail += count < live ? count : live;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::push(const T& value) noexcept {
+    if (is_full()) {
+        return false;
+    }
+    buffer[head & (cap - 1)] = value;
+    head++;
+    return true;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::pop(T& value) noexcept {
+    if (is_empty()) {
+        return false;
+    }
+    value = buffer[tail & (cap - 1)];
+    tail++;
+    return true;
+}
+
+template <typename T>
+bool ext_ring_buffer<T>::peek(T& value) const noexcept {
+    if (is_empty()) return false;
+    value = buffer[tail & (cap - 1)];
+    return true;
+}
@@ -0,0 +1,153 @@
+#include "latency.hpp"
+#include "device.hpp"
+
+constexpr uint64_t latency_ns_per_tick = (uint64_t)(time_step * 1e9 + 0.5);
+constexpr uint64_t latency_value_limit = (uint64_t)1 << latency_max_value_bits;
+
+// Power of two range above the linear part, 0 for the linear part itself
+static uint32_t bucket_shift(uint64_t value) {
+  uint32_t msb = 63 - (uint32_t)__builtin_clzll(value | 1);
+  return msb < latency_sub_bucket_bits ? 0 : msb - latency_sub_bucket_bits;
+}
+
+static uint32_t bucket_index(uint64_t value) {
+  uint32_t shift = bucket_shift(value);
+  return shift * latency_sub_buckets + (uint32_t)(value >> shift);
+}
+
+static uint64_t bucket_highest(uint32_t index) {
+  uint32_t shift = index < latency_sub_buckets ? 0 : index / latency_sub_buckets - 1;
+  uint64_t lowest = (uint64_t)(index - shift * latency_sub_buckets) << shift;
+  return lowest + ((uint64_t)1 << shift) - 1;
+}
+
+void latency_reset(LATENCY_HISTOGRAM &hist) {
+  for (uint32_t i = 0; i < latency_bucket_count; i++) {
+    hist.counts[i] = 0;
+  }
+  hist.total = 0;
+  hist.min = 0;
+  hist.max = 0;
+  hist.clamped = 0;
+  hist.sum = 0.0;
+}
+
+void latency_record(LATENCY_HISTOGRAM &hist, uint64_t value) {
+  if (hist.total == 0 || value < hist.min) {
+    hist.min = value;
+  }
+  if (value > hist.max) {
+    hist.max = value;
+  }
+  hist.total++;
+  hist.sum += (double)value;
+  if (value >= latency_value_limit) {
+    hist.clamped++;
+    value = latency_value_limit - 1;
+  }
+  hist.counts[bucket_index(value)]++;
+}
+
+uint64_t latency_percentile(const LATENCY_HISTOGRAM &hist, double fraction) {
+  if (hist.total == 0) {
+    return 0;
+  }
+  // Nearest rank, rounded up so at least fraction of samples are at or below
+  const double exact = fraction * (double)hist.total;
+  uint64_t rank = exact > 0.0 ? (uint64_t)exact : 0;
+  if ((double)rank < exact) {
+    rank++;
+  }
+  if (rank == 0) {
+    rank = 1;
+  }
+  if (rank > hist.total) {
+    rank = hist.total;
+  }
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < latency_bucket_count; i++) {
+    seen += hist.counts[i];
+    if (seen >= rank) {
+      // The top bucket also holds everything clamped into it
+      uint64_t highest = i + 1 < latency_bucket_count ? bucket_highest(i) : hist.max;
+      return highest < hist.max ? highest : hist.max;
+    }
+  }
+  return hist.max;
+}
+
+LATENCY_SUMMARY latency_summary(const LATENCY_HISTOGRAM &hist) {
+  LATENCY_SUMMARY summary;
+  summary.count = hist.total;
+  summary.min = hist.min;
+  summary.p50 = latency_percentile(hist, 0.50);
+  summary.p99 = latency_percentile(hist, 0.99);
+  summary.p999 = latency_percentile(hist, 0.999);
+  summary.max = hist.max;
+  summary.mean = hist.total != 0 ? hist.sum / (double)hist.total : 0.0;
+  return summary;
+}
+
+void enable_latency(UART_DEVICE &dev, UART_LATENCY &latency) {
+  latency.dev = &dev;
+  latency.peer = nullptr;
+  latency_clear_tags(latency);
+  latency.lost_tags = 0;
+  latency_reset(latency.histogram);
+  dev.latency = &latency;
+}
+
+void latency_clear_tags(UART_LATENCY &latency) {
+  latency.tx_tags.reset();
+  latency.line_tags.reset();
+  latency.tx_bits = 0;
+}
+
+void latency_tx_bits(UART_DEVICE &dev, uint32_t bits) {
+  UART_LATENCY &latency = *dev.latency;
+  const uint32_t data_bits = dev.config.data_bits;
+  if (data_bits == 0) {
+    return;
+  }
+  latency.tx_bits += bits;
+  while (latency.tx_bits >= data_bits) {
+    latency.tx_bits -= data_bits;
+    if (!latency.tx_tags.push(dev.ticks)) {
+      latency.lost_tags++;
+    }
+  }
+}
+
+void latency_tx_frame(UART_DEVICE &dev, bool complete) {
+  UART_LATENCY &latency = *dev.latency;
+  uint32_t tag = 0;
+  if (latency.tx_tags.pop(tag) && latency.peer != nullptr) {
+    UART_LATENCY &peer = *latency.peer;
+    // Carry the age so far over into the peer's tick count
+    uint32_t rebased = peer.dev->ticks - (dev.ticks - tag);
+    if (!complete || !peer.line_tags.push(rebased)) {
+      latency.lost_tags++;
+    }
+  }
+  if (dev.tx_buf.is_empty()) {
+    latency.tx_tags.reset();
+    latency.tx_bits = 0;
+  }
+}
+
+void latency_rx_frame(UART_DEVICE &dev, bool decoded, bool delivered) {
+  UART_LATENCY &latency = *dev.latency;
+  uint32_t tag = 0;
+  if (decoded && latency.line_tags.pop(tag)) {
+    if (delivered) {
+      latency_record(latency.histogram, (uint64_t)(dev.ticks - tag) * latency_ns_per_tick);
+    } else {
+      latency.lost_tags++;
+    }
+  }
+  // Tags with no frame left behind them belong to frames the line lost
+  if (dev.rx_buf.is_empty() && !latency.line_tags.is_empty()) {
+    latency.lost_tags += latency.line_tags.count();
+    latency.line_tags.reset();
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include "ring_buffer.hpp"
+
+struct UART_DEVICE;
+
+// Log-linear (HDR style) histogram in fixed memory. Values below
+// 2^latency_sub_bucket_bits land in their own bucket, above that every power
+// of two range is split into 2^latency_sub_bucket_bits linear buckets, so any
+// recorded value is known to within 1/128 of itself. Values from
+// 2^latency_max_value_bits up are counted in the top bucket.
+constexpr uint32_t latency_sub_bucket_bits = 7;
+constexpr uint32_t latency_max_value_bits = 40;  // Nanoseconds, about 18 simulated minutes
+constexpr uint32_t latency_sub_buckets = 1u << latency_sub_bucket_bits;
+constexpr uint32_t latency_bucket_count = (latency_max_value_bits - latency_sub_bucket_bits + 1) * latency_sub_buckets;
+
+struct LATENCY_HISTOGRAM {
+  uint64_t counts[latency_bucket_count];
+  uint64_t total;
+  uint64_t min;
+  uint64_t max;
+  uint64_t clamped;   // Recorded at or above 2^latency_max_value_bits
+  double sum;
+};
+
+struct LATENCY_SUMMARY {
+  uint64_t count = 0;
+  uint64_t min = 0;
+  uint64_t p50 = 0;
+  uint64_t p99 = 0;
+  uint64_t p999 = 0;
+  uint64_t max = 0;
+  double mean = 0.0;
+};
+
+void latency_reset(LATENCY_HISTOGRAM &hist);
+void latency_record(LATENCY_HISTOGRAM &hist, uint64_t value);
+
+// Highest value the bucket holding the given rank can stand for, never above
+// the largest value recorded. fraction is 0.5 for p50, 0.999 for p999.
+[[nodiscard]] uint64_t latency_percentile(const LATENCY_HISTOGRAM &hist, double fraction);
+[[nodiscard]] LATENCY_SUMMARY latency_summary(const LATENCY_HISTOGRAM &hist);
+
+// Per byte end to end latency of a point to point link, from push_tx_byte()
+// (or the last bit of a character through push_tx_buf()/load_bit_array_tx())
+// on the sender to the byte being decoded into the peer's rx_fifo, in
+// simulated nanoseconds.
+//
+// Timestamps never go on the line. Each character queued in tx_buf gets its
+// enqueue tick in tx_tags; when transmit_frame() puts the frame on the line
+// the tag moves to the peer's line_tags, rebased to the peer's tick count,
+// and receive_frame() pops it when the frame decodes. A frame that is lost
+// on the way drops its tag, and a ring with nothing left behind it on the
+// line is emptied, so tags get back in step after line errors.
+//
+// enable_latency() on both ends before serial_connection(). Bus and shared
+// memory links carry no tags, their receivers record nothing.
+constexpr uint32_t latency_tag_capacity = 1024;
+
+struct UART_LATENCY {
+  UART_DEVICE *dev = nullptr;
+  UART_LATENCY *peer = nullptr;                            // Tracker on the far end of dev's tx line
+  ring_buffer<uint32_t, latency_tag_capacity> tx_tags;     // Enqueue tick of each character in tx_buf
+  ring_buffer<uint32_t, latency_tag_capacity> line_tags;   // Frames on the way into rx_buf, in dev's ticks
+  uint32_t tx_bits = 0;                                    // Queued bits short of a whole character
+  uint32_t lost_tags = 0;                                  // Characters sent but never delivered
+  LATENCY_HISTOGRAM histogram;
+};
+
+void enable_latency(UART_DEVICE &dev, UART_LATENCY &latency);
+
+// Forgets every tag in flight, for when tx_buf and rx_buf are replaced
+// wholesale (snapshot_restore()). The histogram is kept.
+void latency_clear_tags(UART_LATENCY &latency);
+
+// Engine hooks, called from device.cpp when dev.latency is set
+void latency_tx_bits(UART_DEVICE &dev, uint32_t bits);
+void latency_tx_frame(UART_DEVICE &dev, bool complete);
+void latency_rx_frame(UART_DEVICE &dev, bool decoded, bool delivered);
@@ -1,97 +1,19 @@
 #include "device.hpp"
+#include "runtime.hpp"
 #include <array>
 #include <cstdint>
 #include <stdint.h>
 
-// Since it's async each device needs a clock object when rx sees low it means
-// it starts reiceiving data then checks if there is a stop bit then waits for
-// low
-constexpr uint8_t start_bit = 0x00; // low line
-constexpr uint8_t stop_bit = 0x01; // high line
+// Ticks run between feeding uart_one and draining uart_two, short enough
+// that the rx fifo never fills at any supported baud rate
+constexpr uint32_t ticks_per_batch = 64;
 
-constexpr uint32_t discrete_time_step = 1;
-
-static void load_bit_array_tx(UART_DEVICE &dev, uint8_t *bit_arr) {
-  uint32_t data_size = dev.config.data_bits;
-  for (uint32_t binary_iterator = 0; binary_iterator < data_size; binary_iterator++) {
-   dev.tx_buf.push(bit_arr[binary_iterator]);
-  }
-}
-
-static void transition_uart_state(UART_DEVICE &dev) {
-    // This function updates the UART device state based on its buffer status.
-    if (!dev.rx_buf.is_empty()) { // Receiving
-        if (dev.state == DeviceState::TRANSMITTING) {
-            dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-        } else {
-            dev.state = DeviceState::RECEIVING;
-        }
-    }
-
-    if (!dev.tx_buf.is_empty()) { // Transmitting
-        if (dev.state == DeviceState::RECEIVING) {
-            dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-        } else {
-            dev.state = DeviceState::TRANSMITTING;
-        }
-    }
-}
-
-static void handle_receive(UART_DEVICE &dev, uint8_t &reconstructed_character) {
-  if (dev.state == DeviceState::RECEIVING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-    // Reset for new frame
-    reconstructed_character = 0x00;
-    
-    // Need to parse one message from rx_buf
-    uint8_t message_start;
-    uint8_t message_end;
-
-    dev.rx_buf.peek(message_start);
-
-    if (message_start == start_bit) {
-      uint8_t message_start_value;
-      uint8_t message_data_value;
-    
-      dev.rx_buf.pop(message_start_value);
-    
-      for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
-        dev.rx_buf.pop(message_data_value);
-    
-        reconstructed_character = reconstructed_character << 1;
-        reconstructed_character |= message_data_value;
-      }
-      
-      // Move stop bit logic inside the start bit check
-      dev.rx_buf.peek(message_end);
-      if (message_end == stop_bit) {
-        dev.rx_buf.pop(message_end);
-        dev.state = DeviceState::IDLE;
-      } else {
-        // Bad frame
-        dev.rx_buf.reset();
-        dev.state = DeviceState::IDLE;
-      }
-    } else {
-      // Invalid start bit - skip this frame
-      dev.rx_buf.reset();
-      dev.state = DeviceState::IDLE;
-    }
-  }
-}
-
-static void handle_transmit(UART_DEVICE &dev) {
-  if (dev.state == DeviceState::TRANSMITTING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-    send_bit(dev, start_bit);
-    uint8_t send_value;
-
-    for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
-      dev.tx_buf.pop(send_value);
-      send_bit(dev, send_value);
-    }
-    send_bit(dev, stop_bit);
-
-    dev.state = DeviceState::IDLE;
+static uint32_t string_length(const char *str) {
+  uint32_t length = 0;
+  while (str[length] != '\0') {
+    length++;
   }
+  return length;
 }
 
 extern "C" int main() {
@@ -102,6 +24,13 @@ extern "C" int main() {
 
   UART_DEVICE uart_one = {.state = DeviceState::IDLE, .config = default_config};
   UART_DEVICE uart_two = {.state = DeviceState::IDLE, .config = default_config};
+
+  static uint8_t uart_one_tx[buf_capacity_large];
+  static uint8_t uart_one_rx[buf_capacity_large];
+  static uint8_t uart_two_tx[buf_capacity_large];
+  static uint8_t uart_two_rx[buf_capacity_large];
+  attach_buffers(uart_one, uart_one_tx, uart_one_rx);
+  attach_buffers(uart_two, uart_two_tx, uart_two_rx);
   
   // Calculate timing after config is set
   uart_one.calculate_timing();
@@ -110,33 +39,65 @@ extern "C" int main() {
   serial_connection(uart_one, uart_two);
 
   uint32_t simulation_time = 100000;
+  const uint32_t total_ticks = simulation_time;
 
-  // This should be a data register
-  uint8_t reconstructed_character = 0x00;
-  uint8_t reconstructed_character_two = 0x00;
+  const char *message = "UART_EMU_V2 freestanding core\n";
+  const uint32_t message_length = string_length(message);
+  uint32_t message_idx = 0;
 
-  // Need to make helper functions for readability
-  while (simulation_time > 0) {
-    // Main loop here
-    if (is_ready(uart_one)) {
-      reset_clock(uart_one);
-      transition_uart_state(uart_one);
+  static uint8_t received[buf_capacity_large];
+  uint32_t received_count = 0;
+  UART_DEVICE *devices[] = {&uart_one, &uart_two};
+  uint8_t drained[rx_fifo_capacity];
 
-      handle_transmit(uart_one);
-      handle_receive(uart_one, reconstructed_character);
-    }
-    if (is_ready(uart_two)) {
-      reset_clock(uart_two);
-      transition_uart_state(uart_two);
+  const uint64_t start_ns = monotonic_ns();
+  const uint64_t start_cycles = read_cycles();
 
-      handle_transmit(uart_two);
-      handle_receive(uart_two, reconstructed_character_two);
+  while (simulation_time > 0) {
+    // Keep uart_one streaming the message
+    while (push_tx_byte(uart_one, (uint8_t)message[message_idx])) {
+      message_idx = (message_idx + 1) % message_length;
     }
 
-    tick_down(uart_one);
-    tick_down(uart_two);
-    simulation_time -= discrete_time_step;
+    const uint32_t batch = simulation_time < ticks_per_batch ? simulation_time : ticks_per_batch;
+    step_n(devices, 2, batch);
+    simulation_time -= batch;
+
+    const uint32_t drained_count = read_rx_fifo(uart_two, drained, rx_fifo_capacity);
+    for (uint32_t i = 0; i < drained_count; i++) {
+      if (received_count < buf_capacity_large) {
+        received[received_count] = drained[i];
+      }
+      received_count++;
+    }
   }
-    return 0;
+
+  const uint64_t elapsed_cycles = read_cycles() - start_cycles;
+  const uint64_t elapsed_ns = monotonic_ns() - start_ns;
+  const double elapsed_s = (double)elapsed_ns / 1e9;
+  const uint64_t frames = (uint64_t)uart_one.tx_frames + uart_two.rx_frames;
+
+  // Report in one batch so timing is not skewed by per line writes
+  static OUT_BUFFER out;
+  out_init(out, fd_stdout);
+  out_str(out, "received: ");
+  out_bytes(out, received, received_count < message_length ? received_count : message_length);
+  out_str(out, "bytes received: ");
+  out_u64(out, received_count);
+  out_str(out, "\nframes: ");
+  out_u64(out, frames);
+  out_str(out, "\nticks: ");
+  out_u64(out, total_ticks);
+  out_str(out, "\nelapsed ms: ");
+  out_f64(out, elapsed_s * 1e3, 3);
+  out_str(out, "\nframes/s: ");
+  out_f64(out, elapsed_s > 0.0 ? (double)frames / elapsed_s : 0.0, 0);
+  out_str(out, "\ncycles/frame: ");
+  out_f64(out, frames > 0 ? (double)elapsed_cycles / (double)frames : 0.0, 1);
+  out_str(out, "\ncycles/tick: ");
+  out_f64(out, (double)elapsed_cycles / (double)total_ticks, 1);
+  out_char(out, '\n');
+  out_flush(out);
+
+  return 0;
 }
-    
\ No newline at end of file
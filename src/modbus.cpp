@@ -0,0 +1,363 @@
+#include "modbus.hpp"
+#include "packet.hpp"
+
+// Spec values for fast links, where character based timers get too short
+constexpr uint32_t modbus_fixed_timing_baud = 19200;
+constexpr double modbus_fixed_t1_5 = 0.000750;
+constexpr double modbus_fixed_t3_5 = 0.001750;
+
+MODBUS_TIMING modbus_timing(const UART_DEVICE &dev) {
+  MODBUS_TIMING timing;
+  timing.character = dev.time_per_byte;
+  if (dev.config.baud_rate > modbus_fixed_timing_baud) {
+    timing.t1_5 = modbus_fixed_t1_5;
+    timing.t3_5 = modbus_fixed_t3_5;
+  } else {
+    timing.t1_5 = 1.5 * dev.time_per_byte;
+    timing.t3_5 = 3.5 * dev.time_per_byte;
+  }
+  return timing;
+}
+
+// CRC goes out low byte first
+uint32_t modbus_append_crc(uint8_t *adu, uint32_t length) {
+  uint16_t crc = crc16(adu, length);
+  adu[length] = (uint8_t)(crc & 0xFF);
+  adu[length + 1] = (uint8_t)(crc >> 8);
+  return length + 2;
+}
+
+bool modbus_check_crc(const uint8_t *adu, uint32_t length) {
+  if (length < 4) {
+    return false;
+  }
+  uint16_t crc = crc16(adu, length - 2);
+  return adu[length - 2] == (uint8_t)(crc & 0xFF) && adu[length - 1] == (uint8_t)(crc >> 8);
+}
+
+static uint32_t put_u16(uint8_t *out, uint32_t at, uint16_t value) {
+  out[at] = (uint8_t)(value >> 8);
+  out[at + 1] = (uint8_t)(value & 0xFF);
+  return at + 2;
+}
+
+static uint16_t get_u16(const uint8_t *in, uint32_t at) { return (uint16_t)((in[at] << 8) | in[at + 1]); }
+
+uint32_t modbus_read_request(uint8_t *adu, uint8_t slave, uint16_t address, uint16_t quantity) {
+  adu[0] = slave;
+  adu[1] = modbus_read_holding;
+  uint32_t length = put_u16(adu, 2, address);
+  length = put_u16(adu, length, quantity);
+  return modbus_append_crc(adu, length);
+}
+
+uint32_t modbus_write_request(uint8_t *adu, uint8_t slave, uint16_t address, uint16_t value) {
+  adu[0] = slave;
+  adu[1] = modbus_write_single;
+  uint32_t length = put_u16(adu, 2, address);
+  length = put_u16(adu, length, value);
+  return modbus_append_crc(adu, length);
+}
+
+static uint32_t exception_response(uint8_t *response, uint8_t slave, uint8_t function, uint8_t code) {
+  response[0] = slave;
+  response[1] = function | modbus_exception_flag;
+  response[2] = code;
+  return modbus_append_crc(response, 3);
+}
+
+uint32_t modbus_slave_respond(uint16_t *registers, uint8_t slave, const uint8_t *request, uint32_t length,
+                              uint8_t *response) {
+  if (length != 8 || request[0] != slave) {
+    return 0;
+  }
+  uint8_t function = request[1];
+  uint16_t address = get_u16(request, 2);
+  if (function == modbus_read_holding) {
+    uint16_t quantity = get_u16(request, 4);
+    if (quantity == 0 || quantity > modbus_max_read || (uint32_t)address + quantity > modbus_registers) {
+      return exception_response(response, slave, function, modbus_illegal_address);
+    }
+    response[0] = slave;
+    response[1] = function;
+    response[2] = (uint8_t)(quantity * 2);
+    uint32_t out = 3;
+    for (uint16_t i = 0; i < quantity; i++) {
+      out = put_u16(response, out, registers[address + i]);
+    }
+    return modbus_append_crc(response, out);
+  }
+  if (function == modbus_write_single) {
+    if (address >= modbus_registers) {
+      return exception_response(response, slave, function, modbus_illegal_address);
+    }
+    registers[address] = get_u16(request, 4);
+    // The answer echoes the request
+    for (uint32_t i = 0; i < length; i++) {
+      response[i] = request[i];
+    }
+    return length;
+  }
+  return 0;
+}
+
+void modbus_rx_byte(MODBUS_RX &rx, uint8_t value, double now, const MODBUS_TIMING &timing) {
+  if (!rx.active) {
+    rx.active = true;
+    rx.broken = false;
+    rx.length = 0;
+  } else if (now - rx.last_byte > timing.character + timing.t1_5) {
+    // Both times are taken as a byte finishes, so the interval also holds
+    // this byte's own character time
+    rx.broken = true;
+  }
+  rx.last_byte = now;
+  if (rx.length < modbus_max_adu) {
+    rx.adu[rx.length++] = value;
+  } else {
+    rx.broken = true;
+  }
+}
+
+bool modbus_rx_frame(MODBUS_RX &rx, double now, const MODBUS_TIMING &timing) {
+  if (!rx.active || now - rx.last_byte < timing.t3_5) {
+    return false;
+  }
+  rx.active = false;
+  if (rx.broken) {
+    rx.broken_frames++;
+    return false;
+  }
+  if (!modbus_check_crc(rx.adu, rx.length)) {
+    rx.crc_errors++;
+    return false;
+  }
+  rx.frames++;
+  return true;
+}
+
+static uint32_t next_random(MODBUS_WORKLOAD &workload, uint32_t bound) {
+  uint64_t &state = workload.rng;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return (uint32_t)((state >> 32) % bound);
+}
+
+static void reset_node(MODBUS_NODE &node, UART_DEVICE &dev) {
+  node.dev = &dev;
+  node.rx.length = 0;
+  node.rx.active = false;
+  node.rx.broken = false;
+  node.rx.frames = 0;
+  node.rx.crc_errors = 0;
+  node.rx.broken_frames = 0;
+  node.tx_length = 0;
+  node.tx_sent = 0;
+  node.sending = false;
+  node.quiet_since = 0.0;
+}
+
+bool modbus_workload_init(MODBUS_WORKLOAD &workload, UART_BUS &bus, UART_DEVICE &master, UART_DEVICE *const *slaves,
+                          const MODBUS_WORKLOAD_CONFIG &config) {
+  if (config.slave_count == 0 || config.slave_count > modbus_max_slaves || config.max_read == 0 ||
+      config.max_read > modbus_max_read || master.config.data_bits != 8 || master.time_per_byte <= 0.0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < config.slave_count; i++) {
+    if (slaves[i]->config.data_bits != 8 || slaves[i]->time_per_byte <= 0.0) {
+      return false;
+    }
+  }
+  if (!serial_bus(bus, master)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < config.slave_count; i++) {
+    if (!serial_bus(bus, *slaves[i])) {
+      return false;
+    }
+  }
+
+  workload.config = config;
+  workload.timing = modbus_timing(master);
+  workload.bus = &bus;
+  reset_node(workload.master, master);
+  for (uint32_t i = 0; i < config.slave_count; i++) {
+    reset_node(workload.slaves[i], *slaves[i]);
+    for (uint32_t reg = 0; reg < modbus_registers; reg++) {
+      workload.registers[i][reg] = (uint16_t)((i + 1) * 0x100 + reg);
+    }
+  }
+  workload.now = 0.0;
+  workload.ticks = 0;
+  workload.phase = ModbusPhase::IDLE;
+  workload.request_length = 0;
+  workload.rng = config.seed | 1;
+  workload.stats = MODBUS_STATS{};
+  return true;
+}
+
+static void start_sending(MODBUS_WORKLOAD &workload, MODBUS_NODE &node, uint32_t length) {
+  node.tx_length = length;
+  node.tx_sent = 0;
+  node.sending = true;
+  bus_enable_driver(*workload.bus, node.dev->bus_node);
+}
+
+// Keeps tx_buf topped up so the frame leaves without inter character gaps,
+// and drops the driver once the last bit is on the line
+static void feed_node(MODBUS_WORKLOAD &workload, MODBUS_NODE &node) {
+  if (!node.sending) {
+    return;
+  }
+  while (node.tx_sent < node.tx_length && push_tx_byte(*node.dev, node.tx_adu[node.tx_sent])) {
+    node.tx_sent++;
+  }
+  if (node.tx_sent == node.tx_length && node.dev->tx_buf.is_empty()) {
+    bus_disable_driver(*workload.bus, node.dev->bus_node);
+    node.sending = false;
+    node.quiet_since = workload.now;
+  }
+}
+
+// Closes a frame that has gone quiet, then takes in newly decoded bytes
+static bool listen_node(MODBUS_WORKLOAD &workload, MODBUS_NODE &node) {
+  bool framed = modbus_rx_frame(node.rx, workload.now, workload.timing);
+  uint8_t value = 0;
+  while (node.dev->rx_fifo.pop(value)) {
+    modbus_rx_byte(node.rx, value, workload.now, workload.timing);
+    node.quiet_since = workload.now;
+  }
+  return framed;
+}
+
+static bool line_quiet(const MODBUS_WORKLOAD &workload, const MODBUS_NODE &node) {
+  return !node.sending && !node.rx.active && workload.now - node.quiet_since >= workload.timing.t3_5;
+}
+
+static void next_request(MODBUS_WORKLOAD &workload) {
+  const MODBUS_WORKLOAD_CONFIG &config = workload.config;
+  uint8_t slave = (uint8_t)(next_random(workload, config.slave_count) + 1);
+  bool bad_address = next_random(workload, 100) < config.bad_address_percent;
+  uint16_t address = bad_address ? (uint16_t)modbus_registers : 0;
+  if (next_random(workload, 100) < config.write_percent) {
+    if (!bad_address) {
+      address = (uint16_t)next_random(workload, modbus_registers);
+    }
+    workload.request_length =
+        modbus_write_request(workload.request, slave, address, (uint16_t)next_random(workload, 0x10000));
+  } else {
+    uint16_t quantity = (uint16_t)(next_random(workload, config.max_read) + 1);
+    if (!bad_address) {
+      address = (uint16_t)next_random(workload, modbus_registers - quantity + 1);
+    }
+    workload.request_length = modbus_read_request(workload.request, slave, address, quantity);
+  }
+  for (uint32_t i = 0; i < workload.request_length; i++) {
+    workload.master.tx_adu[i] = workload.request[i];
+  }
+  start_sending(workload, workload.master, workload.request_length);
+  workload.request_start = workload.now;
+  workload.phase = ModbusPhase::REQUEST;
+  workload.stats.requests++;
+}
+
+// Same slave and function, and the shape the request asked for
+static bool answers_request(const MODBUS_WORKLOAD &workload, const uint8_t *adu, uint32_t length, bool &exception) {
+  const uint8_t *request = workload.request;
+  exception = false;
+  if (length < 5 || adu[0] != request[0]) {
+    return false;
+  }
+  if (adu[1] == (request[1] | modbus_exception_flag)) {
+    exception = true;
+    return length == 5;
+  }
+  if (adu[1] != request[1]) {
+    return false;
+  }
+  if (request[1] == modbus_read_holding) {
+    uint32_t quantity = get_u16(request, 4);
+    return adu[2] == quantity * 2 && length == 5 + quantity * 2;
+  }
+  if (length != workload.request_length) {
+    return false;
+  }
+  for (uint32_t i = 0; i < length; i++) {
+    if (adu[i] != request[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void master_step(MODBUS_WORKLOAD &workload, bool framed) {
+  MODBUS_NODE &master = workload.master;
+  MODBUS_STATS &stats = workload.stats;
+
+  if (workload.phase == ModbusPhase::REQUEST && !master.sending) {
+    workload.phase = ModbusPhase::RESPONSE;
+    workload.deadline = workload.now + workload.config.timeout_chars * master.dev->time_per_byte;
+  }
+  if (workload.phase == ModbusPhase::RESPONSE && framed) {
+    bool exception = false;
+    if (!answers_request(workload, master.rx.adu, master.rx.length, exception)) {
+      stats.bad_responses++;
+    } else {
+      double latency = workload.now - workload.request_start;
+      stats.transactions++;
+      stats.exceptions += exception ? 1 : 0;
+      stats.latency_total += latency;
+      if (latency > stats.latency_max) {
+        stats.latency_max = latency;
+      }
+      if (workload.latency_handler != nullptr) {
+        workload.latency_handler(latency, workload.latency_ctx);
+      }
+      workload.phase = ModbusPhase::IDLE;
+    }
+  }
+  if (workload.phase == ModbusPhase::RESPONSE && !master.rx.active && workload.now >= workload.deadline) {
+    stats.timeouts++;
+    workload.phase = ModbusPhase::IDLE;
+  }
+  if (workload.phase == ModbusPhase::IDLE && line_quiet(workload, master)) {
+    next_request(workload);
+  }
+}
+
+void modbus_workload_step(MODBUS_WORKLOAD &workload) {
+  const uint32_t slave_count = workload.config.slave_count;
+
+  feed_node(workload, workload.master);
+  for (uint32_t i = 0; i < slave_count; i++) {
+    feed_node(workload, workload.slaves[i]);
+  }
+  step_device(*workload.master.dev);
+  for (uint32_t i = 0; i < slave_count; i++) {
+    step_device(*workload.slaves[i].dev);
+  }
+  workload.now += time_step;
+  workload.ticks++;
+
+  for (uint32_t i = 0; i < slave_count; i++) {
+    MODBUS_NODE &slave = workload.slaves[i];
+    if (listen_node(workload, slave) && !slave.sending) {
+      // Every slave frames all traffic, only the addressed one answers
+      uint32_t length = modbus_slave_respond(workload.registers[i], (uint8_t)(i + 1), slave.rx.adu, slave.rx.length,
+                                             slave.tx_adu);
+      if (length != 0) {
+        start_sending(workload, slave, length);
+      }
+    }
+  }
+  master_step(workload, listen_node(workload, workload.master));
+
+  MODBUS_STATS &stats = workload.stats;
+  stats.crc_errors = workload.master.rx.crc_errors;
+  stats.broken_frames = workload.master.rx.broken_frames;
+  for (uint32_t i = 0; i < slave_count; i++) {
+    stats.crc_errors += workload.slaves[i].rx.crc_errors;
+    stats.broken_frames += workload.slaves[i].rx.broken_frames;
+  }
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include "bus.hpp"
+#include "device.hpp"
+
+// Modbus RTU over the multi-drop bus: one master polling slaves with read
+// holding registers (0x03) and write single register (0x06) requests, to get
+// representative request/response traffic through the engine.
+//
+// RTU has no delimiters, frames are told apart by line silence. A receiver
+// closes a frame after 3.5 character times with no byte, and a gap of more
+// than 1.5 character times inside a frame spoils it. Both come from the
+// device's time_per_byte (calculate_timing()), except above 19200 baud where
+// the spec fixes them at 750 us and 1.75 ms. Every ADU ends with a CRC-16,
+// the same one the packet layer uses.
+constexpr uint32_t modbus_max_adu = 256;
+constexpr uint32_t modbus_max_slaves = 32;
+constexpr uint32_t modbus_registers = 128;       // Holding registers per slave
+constexpr uint32_t modbus_max_read = 125;        // Registers per 0x03 request, spec limit
+
+constexpr uint8_t modbus_read_holding = 0x03;
+constexpr uint8_t modbus_write_single = 0x06;
+constexpr uint8_t modbus_exception_flag = 0x80;
+constexpr uint8_t modbus_illegal_address = 0x02; // Exception code
+
+struct MODBUS_TIMING {
+  double character = 0.0;  // One character on the wire
+  double t1_5 = 0.0;  // Longest gap allowed inside a frame
+  double t3_5 = 0.0;  // Silence that ends a frame and must precede the next
+};
+
+[[nodiscard]] MODBUS_TIMING modbus_timing(const UART_DEVICE &dev);
+
+// ADU helpers, lengths include the CRC
+uint32_t modbus_append_crc(uint8_t *adu, uint32_t length);
+[[nodiscard]] bool modbus_check_crc(const uint8_t *adu, uint32_t length);
+uint32_t modbus_read_request(uint8_t *adu, uint8_t slave, uint16_t address, uint16_t quantity);
+uint32_t modbus_write_request(uint8_t *adu, uint8_t slave, uint16_t address, uint16_t value);
+
+// Answers a request addressed to slave, 0 when it is for someone else
+uint32_t modbus_slave_respond(uint16_t *registers, uint8_t slave, const uint8_t *request, uint32_t length,
+                              uint8_t *response);
+
+// RTU framing on the receive side, fed one decoded byte at a time
+struct MODBUS_RX {
+  uint8_t adu[modbus_max_adu];
+  uint32_t length = 0;
+  double last_byte = 0.0;
+  bool active = false;        // Bytes seen and no 3.5 character silence yet
+  bool broken = false;        // 1.5 character gap or overlong, dropped at the end
+  uint32_t frames = 0;
+  uint32_t crc_errors = 0;
+  uint32_t broken_frames = 0;
+};
+
+void modbus_rx_byte(MODBUS_RX &rx, uint8_t value, double now, const MODBUS_TIMING &timing);
+
+// True once per good frame, left in rx.adu until the next byte arrives
+bool modbus_rx_frame(MODBUS_RX &rx, double now, const MODBUS_TIMING &timing);
+
+struct MODBUS_NODE {
+  UART_DEVICE *dev = nullptr;
+  MODBUS_RX rx;
+  uint8_t tx_adu[modbus_max_adu];
+  uint32_t tx_length = 0;
+  uint32_t tx_sent = 0;       // Bytes handed to tx_buf
+  bool sending = false;       // Driver enabled until tx_buf drains
+  double quiet_since = 0.0;   // Last byte heard or sent
+};
+
+enum class ModbusPhase : uint8_t {
+  IDLE,       // Waiting out 3.5 characters of silence
+  REQUEST,    // Request going out
+  RESPONSE,   // Waiting for the slave, or for the timeout
+};
+
+struct MODBUS_WORKLOAD_CONFIG {
+  uint32_t slave_count = 4;
+  uint32_t max_read = 16;              // Registers per read, 1 to modbus_max_read
+  uint32_t write_percent = 20;         // Share of requests that are writes
+  uint32_t bad_address_percent = 0;    // Share aimed past the register map, answered with an exception
+  uint32_t timeout_chars = 100;        // Response timeout in character times
+  uint64_t seed = 0x9E3779B97F4A7C15ull;
+};
+
+struct MODBUS_STATS {
+  uint32_t requests = 0;
+  uint32_t transactions = 0;   // Answered, exceptions included
+  uint32_t exceptions = 0;
+  uint32_t timeouts = 0;
+  uint32_t bad_responses = 0;  // Well framed but not an answer to the request
+  uint32_t crc_errors = 0;
+  uint32_t broken_frames = 0;
+  double latency_total = 0.0;
+  double latency_max = 0.0;
+};
+
+// Called once per answered transaction with first request byte queued to
+// response frame closed, in simulated seconds
+using modbus_latency_handler = void (*)(double latency, void *ctx);
+
+struct MODBUS_WORKLOAD {
+  MODBUS_WORKLOAD_CONFIG config;
+  MODBUS_TIMING timing;
+  UART_BUS *bus = nullptr;
+  MODBUS_NODE master;
+  MODBUS_NODE slaves[modbus_max_slaves];
+  uint16_t registers[modbus_max_slaves][modbus_registers];
+  double now = 0.0;                  // Simulated seconds
+  uint64_t ticks = 0;
+  ModbusPhase phase = ModbusPhase::IDLE;
+  double request_start = 0.0;
+  double deadline = 0.0;
+  uint8_t request[modbus_max_adu];   // Outstanding request, to check the answer against
+  uint32_t request_length = 0;
+  uint64_t rng = 0;
+  MODBUS_STATS stats;
+  modbus_latency_handler latency_handler = nullptr;
+  void *latency_ctx = nullptr;
+};
+
+// Attaches the master and slaves (addresses 1..slave_count) to bus. Devices
+// need 8 data bits and calculate_timing() done; they must outlive workload.
+bool modbus_workload_init(MODBUS_WORKLOAD &workload, UART_BUS &bus, UART_DEVICE &master, UART_DEVICE *const *slaves,
+                          const MODBUS_WORKLOAD_CONFIG &config);
+
+// One time_step for every device on the bus
+void modbus_workload_step(MODBUS_WORKLOAD &workload);
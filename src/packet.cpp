@@ -0,0 +1,446 @@
+#include "packet.hpp"
+
+// ---- CRC tables, built at compile time ----
+
+struct CRC16_TABLES {
+  uint16_t slice[8][256];
+};
+
+struct CRC32_TABLES {
+  uint32_t slice[8][256];
+};
+
+static constexpr CRC16_TABLES make_crc16_tables() {
+  CRC16_TABLES tables = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint16_t crc = (uint16_t)i;
+    for (uint32_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+    tables.slice[0][i] = crc;
+  }
+  for (uint32_t slice = 1; slice < 8; slice++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint16_t prev = tables.slice[slice - 1][i];
+      tables.slice[slice][i] = (uint16_t)((prev >> 8) ^ tables.slice[0][prev & 0xFF]);
+    }
+  }
+  return tables;
+}
+
+static constexpr CRC32_TABLES make_crc32_tables() {
+  CRC32_TABLES tables = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (uint32_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    }
+    tables.slice[0][i] = crc;
+  }
+  for (uint32_t slice = 1; slice < 8; slice++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t prev = tables.slice[slice - 1][i];
+      tables.slice[slice][i] = (prev >> 8) ^ tables.slice[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+static constexpr CRC16_TABLES crc16_tables = make_crc16_tables();
+static constexpr CRC32_TABLES crc32_tables = make_crc32_tables();
+
+// Byte wise little endian load, the compiler folds it into one mov
+static inline uint32_t load_le32(const uint8_t *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline uint64_t load_le64(const uint8_t *data) {
+  return (uint64_t)load_le32(data) | ((uint64_t)load_le32(data + 4) << 32);
+}
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t length) {
+  const auto &t = crc16_tables.slice;
+  uint32_t state = crc;
+  while (length >= 8) {
+    uint32_t one = load_le32(data) ^ state;
+    uint32_t two = load_le32(data + 4);
+    state = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+            t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    data += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    state = (state >> 8) ^ t[0][(state ^ *data++) & 0xFF];
+  }
+  return (uint16_t)state;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t length) {
+  const auto &t = crc32_tables.slice;
+  uint32_t state = ~crc;
+  while (length >= 8) {
+    uint32_t one = load_le32(data) ^ state;
+    uint32_t two = load_le32(data + 4);
+    state = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+            t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    data += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    state = (state >> 8) ^ t[0][(state ^ *data++) & 0xFF];
+  }
+  return ~state;
+}
+
+// ---- Encoders, fed as payload plus trailer so the CRC is never copied in ----
+
+struct BYTE_PARTS {
+  const uint8_t* first;
+  uint32_t first_length;
+  const uint8_t* second;
+  uint32_t second_length;
+
+  [[nodiscard]] uint32_t length() const { return first_length + second_length; }
+  [[nodiscard]] uint8_t at(uint32_t idx) const { return idx < first_length ? first[idx] : second[idx - first_length]; }
+};
+
+static bool cobs_encode_parts(const BYTE_PARTS &in, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  uint32_t length = in.length();
+  if (out_capacity < cobs_max_encoded(length)) {
+    return false;
+  }
+  uint32_t write = 1;
+  uint32_t code_idx = 0;
+  uint8_t code = 1;
+  for (uint32_t read = 0; read < length; read++) {
+    uint8_t value = in.at(read);
+    if (value == 0) {
+      out[code_idx] = code;
+      code_idx = write++;
+      code = 1;
+      continue;
+    }
+    out[write++] = value;
+    code++;
+    if (code == 0xFF && read + 1 < length) {
+      // Full block, the next one starts without an implied zero
+      out[code_idx] = code;
+      code_idx = write++;
+      code = 1;
+    }
+  }
+  out[code_idx] = code;
+  out[write++] = cobs_delimiter;
+  out_length = write;
+  return true;
+}
+
+static bool slip_encode_parts(const BYTE_PARTS &in, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  uint32_t length = in.length();
+  if (out_capacity < slip_max_encoded(length)) {
+    return false;
+  }
+  uint32_t write = 0;
+  for (uint32_t read = 0; read < length; read++) {
+    uint8_t value = in.at(read);
+    if (value == slip_end) {
+      out[write++] = slip_esc;
+      out[write++] = slip_esc_end;
+    } else if (value == slip_esc) {
+      out[write++] = slip_esc;
+      out[write++] = slip_esc_esc;
+    } else {
+      out[write++] = value;
+    }
+  }
+  out[write++] = slip_end;
+  out_length = write;
+  return true;
+}
+
+bool cobs_encode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  return cobs_encode_parts(BYTE_PARTS{in, length, nullptr, 0}, out, out_capacity, out_length);
+}
+
+bool slip_encode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  return slip_encode_parts(BYTE_PARTS{in, length, nullptr, 0}, out, out_capacity, out_length);
+}
+
+// ---- Decoders, written against an accessor so the same loop runs in place
+// over a wrapped ring. Output never runs ahead of input, which is what makes
+// in place decoding safe. ----
+
+struct LINEAR_BYTES {
+  const uint8_t* in;
+  uint8_t* out;
+  uint8_t read(uint32_t idx) const { return in[idx]; }
+  void write(uint32_t idx, uint8_t value) const { out[idx] = value; }
+};
+
+struct RING_BYTES {
+  uint8_t* storage;
+  uint32_t base;
+  uint32_t mask;
+  uint8_t read(uint32_t idx) const { return storage[(base + idx) & mask]; }
+  void write(uint32_t idx, uint8_t value) const { storage[(base + idx) & mask] = value; }
+};
+
+// length excludes the delimiter
+template <typename BYTES>
+static bool cobs_decode_with(const BYTES &bytes, uint32_t length, uint32_t out_capacity, uint32_t &out_length) {
+  uint32_t read = 0;
+  uint32_t write = 0;
+  while (read < length) {
+    uint8_t code = bytes.read(read++);
+    if (code == 0 || read + code - 1 > length) {
+      return false;
+    }
+    for (uint32_t i = 1; i < code; i++) {
+      if (write == out_capacity) {
+        return false;
+      }
+      bytes.write(write++, bytes.read(read++));
+    }
+    if (code != 0xFF && read < length) {
+      if (write == out_capacity) {
+        return false;
+      }
+      bytes.write(write++, 0);
+    }
+  }
+  out_length = write;
+  return true;
+}
+
+template <typename BYTES>
+static bool slip_decode_with(const BYTES &bytes, uint32_t length, uint32_t out_capacity, uint32_t &out_length) {
+  uint32_t write = 0;
+  for (uint32_t read = 0; read < length; read++) {
+    uint8_t value = bytes.read(read);
+    if (value == slip_esc) {
+      if (++read == length) {
+        return false;
+      }
+      uint8_t escaped = bytes.read(read);
+      if (escaped == slip_esc_end) {
+        value = slip_end;
+      } else if (escaped == slip_esc_esc) {
+        value = slip_esc;
+      } else {
+        return false;
+      }
+    }
+    if (write == out_capacity) {
+      return false;
+    }
+    bytes.write(write++, value);
+  }
+  out_length = write;
+  return true;
+}
+
+bool cobs_decode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  if (length > 0 && in[length - 1] == cobs_delimiter) {
+    length--;
+  }
+  return cobs_decode_with(LINEAR_BYTES{in, out}, length, out_capacity, out_length);
+}
+
+bool slip_decode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length) {
+  if (length > 0 && in[length - 1] == slip_end) {
+    length--;
+  }
+  return slip_decode_with(LINEAR_BYTES{in, out}, length, out_capacity, out_length);
+}
+
+// ---- Reader ----
+
+static uint32_t check_size(PacketCheck check) {
+  switch (check) {
+    case PacketCheck::CRC16:
+      return 2;
+    case PacketCheck::CRC32:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+static uint8_t delimiter_for(PacketFraming framing) {
+  return framing == PacketFraming::COBS ? cobs_delimiter : slip_end;
+}
+
+// Word at a time search, 8 bytes per step on the contiguous stretch
+static uint32_t find_byte(const uint8_t *data, uint32_t length, uint8_t value) {
+  constexpr uint64_t ones = 0x0101010101010101ull;
+  constexpr uint64_t highs = 0x8080808080808080ull;
+  const uint64_t pattern = ones * value;
+  uint32_t idx = 0;
+  while (idx + 8 <= length) {
+    uint64_t word = load_le64(data + idx) ^ pattern;
+    if (((word - ones) & ~word & highs) != 0) {
+      break;
+    }
+    idx += 8;
+  }
+  while (idx < length && data[idx] != value) {
+    idx++;
+  }
+  return idx;
+}
+
+void packet_reader_init(PACKET_READER &reader, uint8_t *storage, uint32_t capacity, PacketFraming framing,
+                        PacketCheck check) {
+  reader = PACKET_READER{};
+  reader.bytes.attach(storage, capacity);
+  reader.framing = framing;
+  reader.check = check;
+}
+
+uint32_t packet_reader_write(PACKET_READER &reader, const uint8_t *data, uint32_t length) {
+  uint32_t written = 0;
+  while (written < length && reader.bytes.push(data[written])) {
+    written++;
+  }
+  return written;
+}
+
+uint32_t packet_reader_fill(PACKET_READER &reader, UART_DEVICE &dev) {
+  uint32_t moved = 0;
+  uint8_t value = 0;
+  while (!reader.bytes.is_full() && dev.rx_fifo.pop(value)) {
+    reader.bytes.push(value);
+    moved++;
+  }
+  return moved;
+}
+
+bool packet_reader_next(PACKET_READER &reader, PACKET_VIEW &view) {
+  if (reader.holding) {
+    return false;
+  }
+  uint8_t *storage = reader.bytes.storage();
+  const uint32_t mask = reader.bytes.capacity() - 1;
+  const uint8_t delimiter = delimiter_for(reader.framing);
+  const uint32_t trailer = check_size(reader.check);
+
+  while (true) {
+    uint32_t live = reader.bytes.count();
+    uint32_t base = reader.bytes.front_index();
+
+    // Look for the delimiter in at most two contiguous stretches
+    uint32_t frame_length = reader.scanned;
+    while (frame_length < live) {
+      uint32_t start = (base + frame_length) & mask;
+      uint32_t stretch = live - frame_length;
+      if (stretch > mask + 1 - start) {
+        stretch = mask + 1 - start;
+      }
+      uint32_t found = find_byte(storage + start, stretch, delimiter);
+      frame_length += found;
+      if (found < stretch) {
+        break;
+      }
+    }
+    if (frame_length >= live) {
+      reader.scanned = live;
+      if (reader.bytes.is_full()) {
+        // No delimiter in a full ring, the frame can never complete
+        reader.bytes.discard(live);
+        reader.scanned = 0;
+        reader.oversize_drops++;
+      }
+      return false;
+    }
+    reader.scanned = 0;
+
+    if (frame_length == 0) {
+      // Back to back delimiters, SLIP senders often lead with END
+      reader.bytes.discard(1);
+      continue;
+    }
+
+    RING_BYTES ring = {storage, base, mask};
+    uint32_t decoded = 0;
+    bool framed = reader.framing == PacketFraming::COBS
+                      ? cobs_decode_with(ring, frame_length, frame_length, decoded)
+                      : slip_decode_with(ring, frame_length, frame_length, decoded);
+    if (!framed || decoded < trailer) {
+      reader.framing_errors++;
+      reader.bytes.discard(frame_length + 1);
+      continue;
+    }
+
+    uint32_t payload = decoded - trailer;
+    uint32_t start = base & mask;
+    view.first = storage + start;
+    view.first_length = payload <= mask + 1 - start ? payload : mask + 1 - start;
+    view.second = storage;
+    view.second_length = payload - view.first_length;
+    view.frame_length = frame_length + 1;
+
+    bool check_ok = true;
+    if (reader.check == PacketCheck::CRC16) {
+      uint16_t crc = crc16_update(crc16_init, view.first, view.first_length);
+      crc = crc16_update(crc, view.second, view.second_length);
+      check_ok = crc == (uint16_t)(ring.read(payload) | (ring.read(payload + 1) << 8));
+    } else if (reader.check == PacketCheck::CRC32) {
+      uint32_t crc = crc32_update(crc32_init, view.first, view.first_length);
+      crc = crc32_update(crc, view.second, view.second_length);
+      uint32_t sent = (uint32_t)ring.read(payload) | ((uint32_t)ring.read(payload + 1) << 8) |
+                      ((uint32_t)ring.read(payload + 2) << 16) | ((uint32_t)ring.read(payload + 3) << 24);
+      check_ok = crc == sent;
+    }
+    if (!check_ok) {
+      reader.crc_errors++;
+      reader.bytes.discard(view.frame_length);
+      continue;
+    }
+
+    reader.packets++;
+    reader.holding = true;
+    return true;
+  }
+}
+
+void packet_reader_release(PACKET_READER &reader, const PACKET_VIEW &view) {
+  reader.bytes.discard(view.frame_length);
+  reader.holding = false;
+}
+
+bool packet_send(UART_DEVICE &dev, PacketFraming framing, PacketCheck check, const uint8_t *payload,
+                 uint32_t length, uint8_t *scratch, uint32_t scratch_capacity) {
+  // Framing works on whole octets
+  if (dev.config.data_bits != 8) {
+    return false;
+  }
+  uint8_t trailer[4] = {0, 0, 0, 0};
+  uint32_t trailer_length = check_size(check);
+  if (check == PacketCheck::CRC16) {
+    uint16_t crc = crc16(payload, length);
+    trailer[0] = (uint8_t)(crc & 0xFF);
+    trailer[1] = (uint8_t)(crc >> 8);
+  } else if (check == PacketCheck::CRC32) {
+    uint32_t crc = crc32(payload, length);
+    for (uint32_t i = 0; i < 4; i++) {
+      trailer[i] = (uint8_t)(crc >> (8 * i));
+    }
+  }
+
+  BYTE_PARTS parts = {payload, length, trailer, trailer_length};
+  uint32_t encoded = 0;
+  bool framed = framing == PacketFraming::COBS ? cobs_encode_parts(parts, scratch, scratch_capacity, encoded)
+                                               : slip_encode_parts(parts, scratch, scratch_capacity, encoded);
+  if (!framed) {
+    return false;
+  }
+
+  // All or nothing so a partial frame never reaches the line
+  if (dev.tx_buf.capacity() - dev.tx_buf.count() < encoded * dev.config.data_bits) {
+    return false;
+  }
+  for (uint32_t i = 0; i < encoded; i++) {
+    push_tx_byte(dev, scratch[i]);
+  }
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include "device.hpp"
+#include "ext_ring_buffer.hpp"
+
+// Packet layer over the decoded byte stream: COBS or SLIP framing with an
+// optional CRC trailer. Received packets are decoded in place inside the
+// reader's ring and handed out as views, the payload is never copied out.
+
+// CRC-16/MODBUS (reflected 0x8005, init 0xFFFF) and CRC-32 (reflected
+// 0x04C11DB7, zlib style). Both are slicing-by-8 and chain across calls, so a
+// payload split over a ring wrap is checked in two pieces.
+constexpr uint16_t crc16_init = 0xFFFF;
+constexpr uint32_t crc32_init = 0;
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t length);
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t length);
+inline uint16_t crc16(const uint8_t *data, uint32_t length) { return crc16_update(crc16_init, data, length); }
+inline uint32_t crc32(const uint8_t *data, uint32_t length) { return crc32_update(crc32_init, data, length); }
+
+// Encoded output never contains 0x00 (COBS) or a bare END (SLIP). The frame
+// delimiter is appended by the encoders. Buffers must not overlap.
+constexpr uint8_t cobs_delimiter = 0x00;
+constexpr uint8_t slip_end = 0xC0;
+constexpr uint8_t slip_esc = 0xDB;
+constexpr uint8_t slip_esc_end = 0xDC;
+constexpr uint8_t slip_esc_esc = 0xDD;
+
+// Worst case encoded sizes including the delimiter
+constexpr uint32_t cobs_max_encoded(uint32_t length) { return length + length / 254 + 2; }
+constexpr uint32_t slip_max_encoded(uint32_t length) { return length * 2 + 1; }
+
+bool cobs_encode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length);
+bool cobs_decode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length);
+bool slip_encode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length);
+bool slip_decode(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t out_capacity, uint32_t &out_length);
+
+enum class PacketFraming : uint8_t {
+  COBS,
+  SLIP,
+};
+
+enum class PacketCheck : uint8_t {
+  NONE,
+  CRC16, // 2 byte little endian trailer, Modbus order
+  CRC32, // 4 byte little endian trailer
+};
+
+// A payload inside the reader ring, split in two when it wraps
+struct PACKET_VIEW {
+  const uint8_t* first = nullptr;
+  uint32_t first_length = 0;
+  const uint8_t* second = nullptr;
+  uint32_t second_length = 0;
+  uint32_t frame_length = 0;  // Encoded bytes plus delimiter, released together
+
+  [[nodiscard]] uint32_t length() const { return first_length + second_length; }
+  [[nodiscard]] uint8_t at(uint32_t idx) const { return idx < first_length ? first[idx] : second[idx - first_length]; }
+};
+
+struct PACKET_READER {
+  ext_ring_buffer<uint8_t> bytes = {};
+  PacketFraming framing = PacketFraming::COBS;
+  PacketCheck check = PacketCheck::CRC16;
+  uint32_t scanned = 0;        // Bytes past the tail already known to hold no delimiter
+  bool holding = false;        // A view is out, bytes stay put until released
+  uint32_t packets = 0;
+  uint32_t crc_errors = 0;
+  uint32_t framing_errors = 0;
+  uint32_t oversize_drops = 0;
+};
+
+// storage capacity must be a power of two and bigger than the largest encoded frame
+void packet_reader_init(PACKET_READER &reader, uint8_t *storage, uint32_t capacity, PacketFraming framing,
+                        PacketCheck check);
+
+// Moves decoded bytes from the device's rx_fifo into the reader ring
+uint32_t packet_reader_fill(PACKET_READER &reader, UART_DEVICE &dev);
+uint32_t packet_reader_write(PACKET_READER &reader, const uint8_t *data, uint32_t length);
+
+// Next valid packet, bad frames are counted and skipped. The view stays valid
+// until packet_reader_release().
+bool packet_reader_next(PACKET_READER &reader, PACKET_VIEW &view);
+void packet_reader_release(PACKET_READER &reader, const PACKET_VIEW &view);
+
+// Frames payload plus check into scratch, then queues it whole on the device
+// or not at all. Needs 8 data bits.
+bool packet_send(UART_DEVICE &dev, PacketFraming framing, PacketCheck check, const uint8_t *payload,
+                 uint32_t length, uint8_t *scratch, uint32_t scratch_capacity);
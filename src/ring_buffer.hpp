@@ -26,6 +26,7 @@ public:
 
     [[nodiscard]] bool is_empty() const noexcept;
     [[nodiscard]] bool is_full()  const noexcept;
+    [[nodiscard]] uint32_t count() const noexcept;
 
     bool push(const T& value) noexcept;
     bool pop(T& value) noexcept;
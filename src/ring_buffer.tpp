@@ -4,11 +4,12 @@ ring_buffer<T, N>::ring_buffer() noexcept : head(0), tail(0), size(0) {}
 template <typename T, uint32_t N>
 ring_buffer<T, N>::~ring_buffer() noexcept {}
 
+// Copies and moves only walk the live slots between tail and head
 template <typename T, uint32_t N>
 ring_buffer<T, N>::ring_buffer(const ring_buffer& other) noexcept
     : head(other.head), tail(other.tail), size(other.size) {
-    for (uint32_t i = 0; i < N; ++i) {
-        buffer[i] = other.buffer[i];
+    for (uint32_t i = 0, idx = tail; i < size; ++i, idx = (idx + 1) & (N - 1)) {
+        buffer[idx] = other.buffer[idx];
     }
 }
 
@@ -18,8 +19,8 @@ ring_buffer<T, N>& ring_buffer<T, N>::operator=(const ring_buffer& other) noexce
         head = other.head;
         tail = other.tail;
         size = other.size;
-        for (uint32_t i = 0; i < N; ++i) {
-            buffer[i] = other.buffer[i];
+        for (uint32_t i = 0, idx = tail; i < size; ++i, idx = (idx + 1) & (N - 1)) {
+            buffer[idx] = other.buffer[idx];
         }
     }
     return *this;
@@ -28,8 +29,8 @@ ring_buffer<T, N>& ring_buffer<T, N>::operator=(const ring_buffer& other) noexce
 template <typename T, uint32_t N>
 ring_buffer<T, N>::ring_buffer(ring_buffer&& other) noexcept
     : head(other.head), tail(other.tail), size(other.size) {
-    for (uint32_t i = 0; i < N; ++i) {
-        buffer[i] = static_cast<T&&>(other.buffer[i]);
+    for (uint32_t i = 0, idx = tail; i < size; ++i, idx = (idx + 1) & (N - 1)) {
+        buffer[idx] = static_cast<T&&>(other.buffer[idx]);
     }
     other.head = 0;
     other.tail = 0;
@@ -42,8 +43,8 @@ ring_buffer<T, N>& ring_buffer<T, N>::operator=(ring_buffer&& other) noexcept {
         head = other.head;
         tail = other.tail;
         size = other.size;
-        for (uint32_t i = 0; i < N; ++i) {
-            buffer[i] = static_cast<T&&>(other.buffer[i]);
+        for (uint32_t i = 0, idx = tail; i < size; ++i, idx = (idx + 1) & (N - 1)) {
+            buffer[idx] = static_cast<T&&>(other.buffer[idx]);
         }
         other.head = 0;
         other.tail = 0;
@@ -70,6 +71,11 @@ bool ring_buffer<T, N>::is_full() const noexcept {
     return size == N;
 }
 
+template <typename T, uint32_t N>
+uint32_t ring_buffer<T, N>::count() const noexcept {
+    return size;
+}
+
 template <typename T, uint32_t N>
 bool ring_buffer<T, N>::push(const T& value) noexcept {
     if (is_full()) {
@@ -0,0 +1,108 @@
+#include "runtime.hpp"
+
+constexpr uint64_t sys_nr_write = 1;
+constexpr uint64_t sys_nr_clock_gettime = 228;
+
+static inline int64_t syscall3(uint64_t number, uint64_t arg0, uint64_t arg1, uint64_t arg2) {
+  int64_t result;
+  asm volatile("syscall"
+               : "=a"(result)
+               : "a"(number), "D"(arg0), "S"(arg1), "d"(arg2)
+               : "rcx", "r11", "memory");
+  return result;
+}
+
+int64_t sys_write(int fd, const void *buf, uint64_t count) {
+  return syscall3(sys_nr_write, (uint64_t)fd, (uint64_t)buf, count);
+}
+
+int64_t sys_clock_gettime(int clock_id, KERNEL_TIMESPEC *ts) {
+  return syscall3(sys_nr_clock_gettime, (uint64_t)clock_id, (uint64_t)ts, 0);
+}
+
+uint64_t monotonic_ns() {
+  KERNEL_TIMESPEC ts = {0, 0};
+  sys_clock_gettime(clock_monotonic, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t read_cycles() {
+#if defined(__x86_64__)
+  uint32_t low;
+  uint32_t high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return ((uint64_t)high << 32) | low;
+#else
+  return monotonic_ns();
+#endif
+}
+
+void out_init(OUT_BUFFER &out, int fd) {
+  out.fd = fd;
+  out.length = 0;
+}
+
+void out_flush(OUT_BUFFER &out) {
+  uint32_t written = 0;
+  while (written < out.length) {
+    int64_t result = sys_write(out.fd, out.data + written, out.length - written);
+    if (result <= 0) {
+      // Nowhere to report it, drop the batch
+      break;
+    }
+    written += (uint32_t)result;
+  }
+  out.length = 0;
+}
+
+void out_char(OUT_BUFFER &out, char value) {
+  if (out.length == out_buffer_capacity) {
+    out_flush(out);
+  }
+  out.data[out.length++] = value;
+}
+
+void out_bytes(OUT_BUFFER &out, const uint8_t *data, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    out_char(out, (char)data[i]);
+  }
+}
+
+void out_str(OUT_BUFFER &out, const char *str) {
+  while (*str != '\0') {
+    out_char(out, *str++);
+  }
+}
+
+void out_u64(OUT_BUFFER &out, uint64_t value) {
+  char digits[20];
+  uint32_t count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (count > 0) {
+    out_char(out, digits[--count]);
+  }
+}
+
+void out_f64(OUT_BUFFER &out, double value, uint32_t decimals) {
+  if (value < 0.0) {
+    out_char(out, '-');
+    value = -value;
+  }
+  uint64_t scale = 1;
+  for (uint32_t i = 0; i < decimals; i++) {
+    scale *= 10;
+  }
+  uint64_t fixed = (uint64_t)(value * (double)scale + 0.5);
+  out_u64(out, fixed / scale);
+  if (decimals == 0) {
+    return;
+  }
+  out_char(out, '.');
+  uint64_t fraction = fixed % scale;
+  for (uint64_t digit = scale / 10; digit > 0; digit /= 10) {
+    out_char(out, (char)('0' + (fraction / digit) % 10));
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+// Minimal runtime for the freestanding build: raw Linux x86_64 syscalls, a
+// fixed buffer formatter that only hits write() when full or flushed, and
+// cycle counters for timing the core without libc in the way.
+
+struct KERNEL_TIMESPEC {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+constexpr int fd_stdout = 1;
+constexpr int fd_stderr = 2;
+constexpr int clock_monotonic = 1;
+
+int64_t sys_write(int fd, const void *buf, uint64_t count);
+int64_t sys_clock_gettime(int clock_id, KERNEL_TIMESPEC *ts);
+
+uint64_t monotonic_ns();
+uint64_t read_cycles(); // rdtsc, monotonic_ns() where there is no TSC
+
+constexpr uint32_t out_buffer_capacity = 4096;
+
+struct OUT_BUFFER {
+  int fd;
+  uint32_t length;
+  char data[out_buffer_capacity];
+};
+
+void out_init(OUT_BUFFER &out, int fd);
+void out_flush(OUT_BUFFER &out);
+void out_char(OUT_BUFFER &out, char value);
+void out_bytes(OUT_BUFFER &out, const uint8_t *data, uint32_t count);
+void out_str(OUT_BUFFER &out, const char *str);
+void out_u64(OUT_BUFFER &out, uint64_t value);
+void out_f64(OUT_BUFFER &out, double value, uint32_t decimals);
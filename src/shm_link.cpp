@@ -0,0 +1,202 @@
+#include "shm_link.hpp"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be 32 bits wide.");
+
+static inline uint32_t align_line(uint32_t value) {
+  return (value + cache_line_size - 1) & ~(cache_line_size - 1);
+}
+
+// Shared futexes, the waiter and the waker are in different processes
+static long futex_wait(std::atomic<uint32_t> &word, uint32_t expected, uint64_t timeout_ns) {
+  timespec timeout = {(time_t)(timeout_ns / 1000000000ull), (long)(timeout_ns % 1000000000ull)};
+  return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t> &word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static SHM_RING &outbound_ring(SHM_LINK &link) { return link.header->rings[link.side]; }
+
+static SHM_RING &inbound_ring(SHM_LINK &link) { return link.header->rings[link.side ^ 1]; }
+
+static uint8_t *ring_storage(SHM_LINK &link, uint32_t ring) {
+  return link.region + link.header->data_offset + ring * link.header->capacity;
+}
+
+static bool map_region(SHM_LINK &link, int fd, size_t size) {
+  void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (region == MAP_FAILED) {
+    return false;
+  }
+  link.region = static_cast<uint8_t *>(region);
+  link.region_size = size;
+  link.header = reinterpret_cast<SHM_LINK_HEADER *>(region);
+  link.fd = fd;
+  return true;
+}
+
+static void copy_name(SHM_LINK &link, const char *name) {
+  link.name[0] = '\0';
+  if (name != nullptr) {
+    strncpy(link.name, name, shm_link_name_capacity - 1);
+    link.name[shm_link_name_capacity - 1] = '\0';
+  }
+}
+
+bool shm_link_create(SHM_LINK &link, const char *name, uint32_t capacity) {
+  capacity = floor_power_of_two(capacity);
+  if (capacity == 0 || (name != nullptr && strlen(name) >= shm_link_name_capacity)) {
+    return false;
+  }
+  int fd = name != nullptr ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600) : memfd_create("uart_shm_link", 0);
+  if (fd < 0) {
+    return false;
+  }
+  uint32_t data_offset = align_line(sizeof(SHM_LINK_HEADER));
+  size_t size = (size_t)data_offset + 2 * (size_t)capacity;
+  if (ftruncate(fd, (off_t)size) != 0 || !map_region(link, fd, size)) {
+    close(fd);
+    if (name != nullptr) {
+      shm_unlink(name);
+    }
+    return false;
+  }
+
+  // The mapping starts zeroed, only the layout needs writing before the
+  // magic tells an opener the region is usable
+  SHM_LINK_HEADER &header = *link.header;
+  header.version = shm_link_version;
+  header.capacity = capacity;
+  header.data_offset = data_offset;
+  header.magic.store(shm_link_magic, std::memory_order_release);
+
+  link.side = 0;
+  link.owner = true;
+  copy_name(link, name);
+  return true;
+}
+
+bool shm_link_open_fd(SHM_LINK &link, int fd) {
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SHM_LINK_HEADER)) {
+    return false;
+  }
+  size_t size = (size_t)info.st_size;
+  if (!map_region(link, fd, size)) {
+    return false;
+  }
+  const SHM_LINK_HEADER &header = *link.header;
+  if (header.magic.load(std::memory_order_acquire) != shm_link_magic || header.version != shm_link_version ||
+      header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+      header.data_offset < sizeof(SHM_LINK_HEADER) || (size_t)header.data_offset + 2 * (size_t)header.capacity > size) {
+    munmap(link.region, size);
+    link.header = nullptr;
+    link.region = nullptr;
+    link.region_size = 0;
+    link.fd = -1;
+    return false;
+  }
+  link.side = 1;
+  link.owner = false;
+  link.name[0] = '\0';
+  return true;
+}
+
+bool shm_link_open(SHM_LINK &link, const char *name) {
+  int fd = shm_open(name, O_RDWR, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  if (!shm_link_open_fd(link, fd)) {
+    close(fd);
+    return false;
+  }
+  return true;
+}
+
+void shm_link_close(SHM_LINK &link) {
+  if (link.region != nullptr) {
+    munmap(link.region, link.region_size);
+  }
+  if (link.fd >= 0) {
+    close(link.fd);
+  }
+  if (link.owner && link.name[0] != '\0') {
+    shm_unlink(link.name);
+  }
+  link.header = nullptr;
+  link.region = nullptr;
+  link.region_size = 0;
+  link.fd = -1;
+  link.owner = false;
+  link.outbound.attach(nullptr, 0);
+}
+
+void shm_link_attach(SHM_LINK &link, UART_DEVICE &dev) {
+  SHM_RING &out = outbound_ring(link);
+  SHM_RING &in = inbound_ring(link);
+  uint32_t capacity = link.header->capacity;
+
+  link.outbound.attach(ring_storage(link, link.side), capacity);
+  link.outbound.set_indices(out.head.load(std::memory_order_relaxed), out.tail.load(std::memory_order_acquire));
+
+  link.rx_head = in.head.load(std::memory_order_acquire);
+  link.rx_tail = in.tail.load(std::memory_order_relaxed);
+  dev.rx_buf.attach(ring_storage(link, link.side ^ 1), capacity);
+  dev.rx_buf.set_indices(link.rx_head, link.rx_tail);
+  dev.tx_serial_connection = &link.outbound;
+  dev.bus = nullptr;
+  dev.bus_node = bus_no_node;
+}
+
+void shm_link_sync(SHM_LINK &link, UART_DEVICE &dev) {
+  SHM_RING &out = outbound_ring(link);
+  SHM_RING &in = inbound_ring(link);
+
+  // Outbound: publish what the device sent, learn what the peer freed
+  uint32_t out_head = link.outbound.back_index();
+  if (out_head != out.head.load(std::memory_order_relaxed)) {
+    out.head.store(out_head, std::memory_order_seq_cst);
+    if (out.reader_waiting.load(std::memory_order_seq_cst) != 0) {
+      futex_wake(out.head);
+    }
+  }
+  link.outbound.set_indices(out_head, out.tail.load(std::memory_order_acquire));
+
+  // Inbound: reset() on a bad frame zeroes both indices, which we read as
+  // consuming everything shown at the last sync
+  uint32_t consumed = dev.rx_buf.back_index() == link.rx_head ? dev.rx_buf.front_index() - link.rx_tail
+                                                              : link.rx_head - link.rx_tail;
+  link.rx_tail += consumed;
+  in.tail.store(link.rx_tail, std::memory_order_release);
+  link.rx_head = in.head.load(std::memory_order_acquire);
+  dev.rx_buf.set_indices(link.rx_head, link.rx_tail);
+}
+
+bool shm_link_wait(SHM_LINK &link, uint64_t timeout_ns) {
+  SHM_RING &in = inbound_ring(link);
+  uint32_t head = in.head.load(std::memory_order_acquire);
+  if (head != link.rx_tail) {
+    return true;
+  }
+  // Announce before the last look so a sender that misses the flag has
+  // published a head we are about to see
+  in.reader_waiting.store(1, std::memory_order_seq_cst);
+  head = in.head.load(std::memory_order_seq_cst);
+  if (head == link.rx_tail) {
+    futex_wait(in.head, head, timeout_ns);
+  }
+  in.reader_waiting.store(0, std::memory_order_relaxed);
+  return in.head.load(std::memory_order_acquire) != link.rx_tail;
+}
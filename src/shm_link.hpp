@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "device.hpp"
+
+// Point to point link between two processes over POSIX shared memory. The
+// region holds one single producer/single consumer ring of line bits per
+// direction. Each end's device works on the shared storage in place: its
+// rx_buf is attached to the inbound ring and its tx_serial_connection points
+// at a local view of the outbound ring, so a bit is written once by the
+// sender and decoded straight out of the mapping by the receiver.
+//
+// Only indices cross the process boundary, in shm_link_sync(). Between syncs
+// each side sees a private snapshot of the rings, so frames are published
+// whole as long as sync is called between service_device() calls. A reader
+// with nothing to do sleeps on a futex on the inbound head.
+//
+// Hosted only (shm_open, mmap, futex), it is left out of the freestanding app.
+constexpr uint32_t shm_link_magic = 0x4B4E4C53; // "SLNK"
+constexpr uint32_t shm_link_version = 1;
+constexpr uint32_t shm_link_default_capacity = 4096;
+constexpr uint32_t shm_link_name_capacity = 64;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Futex words must be plain lock free 32 bit atomics.");
+
+// Producer and consumer indices on separate cache lines
+struct SHM_RING {
+  alignas(cache_line_size) std::atomic<uint32_t> head;  // Written by the sender, futex word for the reader
+  alignas(cache_line_size) std::atomic<uint32_t> tail;  // Written by the receiver
+  std::atomic<uint32_t> reader_waiting;                 // Receiver is in or entering futex wait
+};
+
+struct SHM_LINK_HEADER {
+  std::atomic<uint32_t> magic;  // Stored last by the creator
+  uint32_t version;
+  uint32_t capacity;            // Line bits per direction, power of two
+  uint32_t data_offset;         // Ring 0 storage, ring 1 follows it
+  SHM_RING rings[2];            // Side 0 sends on ring 0, side 1 on ring 1
+};
+
+// Per process end of a link
+struct SHM_LINK {
+  SHM_LINK_HEADER *header = nullptr;
+  uint8_t *region = nullptr;
+  size_t region_size = 0;
+  int fd = -1;
+  uint8_t side = 0;
+  bool owner = false;                          // Created the region, unlinks its name on close
+  char name[shm_link_name_capacity] = {};
+  ext_ring_buffer<uint8_t> outbound = {};      // Local view of our sending ring
+  uint32_t rx_head = 0;                        // Inbound indices at the last sync
+  uint32_t rx_tail = 0;
+};
+
+// Creates side 0. A null name makes an anonymous memfd, hand fd to the peer
+// (fork or SCM_RIGHTS) for shm_link_open_fd(). capacity is rounded down to a
+// power of two.
+bool shm_link_create(SHM_LINK &link, const char *name, uint32_t capacity = shm_link_default_capacity);
+
+// Opens side 1. Fails until the creator has finished initializing the region.
+bool shm_link_open(SHM_LINK &link, const char *name);
+bool shm_link_open_fd(SHM_LINK &link, int fd);
+
+void shm_link_close(SHM_LINK &link);
+
+// Wires a device to this end. Replaces its rx_buf storage and peer, the
+// previous rx_buf contents are dropped.
+void shm_link_attach(SHM_LINK &link, UART_DEVICE &dev);
+
+// Publishes bits the device sent and bits it consumed, then picks up the
+// peer's. A device that flushed rx_buf after a bad frame drops everything it
+// had been shown. Wakes the peer if it is waiting.
+void shm_link_sync(SHM_LINK &link, UART_DEVICE &dev);
+
+// Sleeps until the peer publishes bits we have not consumed, or timeout_ns
+// passes. Returns true when there is something to receive.
+bool shm_link_wait(SHM_LINK &link, uint64_t timeout_ns);
@@ -0,0 +1,202 @@
+#include "snapshot.hpp"
+#include "latency.hpp"
+
+static inline uint32_t align8(uint32_t value) { return (value + 7u) & ~7u; }
+
+static void copy_bytes(void *dst, const void *src, uint32_t count) {
+  uint8_t *out = static_cast<uint8_t *>(dst);
+  const uint8_t *in = static_cast<const uint8_t *>(src);
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = in[i];
+  }
+}
+
+static uint32_t storage_size(const UART_DEVICE *const *devices, uint32_t device_count) {
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < device_count; i++) {
+    size += align8(devices[i]->tx_buf.capacity()) + align8(devices[i]->rx_buf.capacity());
+  }
+  return size;
+}
+
+uint32_t snapshot_size(const UART_DEVICE *const *devices, uint32_t device_count, uint32_t bus_count) {
+  return sizeof(SNAPSHOT_HEADER) + device_count * sizeof(SNAPSHOT_DEVICE) + bus_count * align8(sizeof(UART_BUS)) +
+         storage_size(devices, device_count);
+}
+
+static SNAPSHOT_RING save_ring(const ext_ring_buffer<uint8_t> &ring, uint8_t *image, uint32_t &offset) {
+  SNAPSHOT_RING saved = {ring.back_index(), ring.front_index(), ring.capacity(), offset};
+  copy_bytes(image + offset, ring.storage(), ring.capacity());
+  offset += align8(ring.capacity());
+  return saved;
+}
+
+uint32_t snapshot_save(const UART_DEVICE *const *devices, uint32_t device_count, const UART_BUS *buses,
+                       uint32_t bus_count, uint8_t *out, uint32_t out_capacity) {
+  uint32_t total_size = snapshot_size(devices, device_count, bus_count);
+  if (out_capacity < total_size) {
+    return 0;
+  }
+
+  SNAPSHOT_HEADER header = {};
+  header.magic = snapshot_magic;
+  header.version = snapshot_version;
+  header.total_size = total_size;
+  header.device_count = device_count;
+  header.bus_count = bus_count;
+  header.devices_offset = sizeof(SNAPSHOT_HEADER);
+  header.buses_offset = header.devices_offset + device_count * sizeof(SNAPSHOT_DEVICE);
+  header.storage_offset = header.buses_offset + bus_count * align8(sizeof(UART_BUS));
+
+  uint32_t storage_offset = header.storage_offset;
+  for (uint32_t i = 0; i < device_count; i++) {
+    const UART_DEVICE &dev = *devices[i];
+    SNAPSHOT_DEVICE saved = {};
+    saved.peer = snapshot_no_link;
+    saved.bus = snapshot_no_link;
+    for (uint32_t j = 0; j < device_count && dev.tx_serial_connection != nullptr; j++) {
+      if (dev.tx_serial_connection == &devices[j]->rx_buf) {
+        saved.peer = j;
+        break;
+      }
+    }
+    for (uint32_t j = 0; j < bus_count && dev.bus != nullptr; j++) {
+      if (dev.bus == &buses[j]) {
+        saved.bus = j;
+        break;
+      }
+    }
+    // A link we cannot name by index cannot be restored
+    if ((dev.tx_serial_connection != nullptr && saved.peer == snapshot_no_link) ||
+        (dev.bus != nullptr && saved.bus == snapshot_no_link)) {
+      return 0;
+    }
+
+    saved.clock = dev.clock;
+    saved.time_per_byte = dev.time_per_byte;
+    saved.config_time_step = dev.config.time_step;
+    saved.baud_rate = dev.config.baud_rate;
+    saved.data_bits = dev.config.data_bits;
+    saved.stop_bits = dev.config.stop_bits;
+    saved.start_bits = dev.config.start_bits;
+    saved.bits_per_frame = dev.bits_per_frame;
+    saved.rx_threshold = dev.rx_threshold;
+    saved.rx_fifo_depth = dev.rx_fifo_depth;
+    saved.frame_errors = dev.frame_errors;
+    saved.rx_overruns = dev.rx_overruns;
+    saved.tx_frames = dev.tx_frames;
+    saved.rx_frames = dev.rx_frames;
+    saved.dropped_bits = dev.dropped_bits;
+    saved.ticks = dev.ticks;
+    saved.state = (uint8_t)dev.state;
+    saved.bus_node = dev.bus_node;
+    saved.event_mask = dev.event_mask;
+    saved.tx_buf = save_ring(dev.tx_buf, out, storage_offset);
+    saved.rx_buf = save_ring(dev.rx_buf, out, storage_offset);
+
+    ring_buffer<uint8_t, rx_fifo_capacity> fifo = dev.rx_fifo;
+    uint8_t value = 0;
+    while (fifo.pop(value)) {
+      saved.rx_fifo[saved.rx_fifo_count++] = value;
+    }
+
+    copy_bytes(out + header.devices_offset + i * sizeof(SNAPSHOT_DEVICE), &saved, sizeof(saved));
+  }
+  for (uint32_t i = 0; i < bus_count; i++) {
+    copy_bytes(out + header.buses_offset + i * align8(sizeof(UART_BUS)), &buses[i], sizeof(UART_BUS));
+  }
+  copy_bytes(out, &header, sizeof(header));
+  return total_size;
+}
+
+static bool ring_fits(const SNAPSHOT_RING &saved, const ext_ring_buffer<uint8_t> &ring, const SNAPSHOT_HEADER &header) {
+  return saved.capacity == ring.capacity() && saved.head - saved.tail <= saved.capacity &&
+         saved.storage_offset >= header.storage_offset && saved.storage_offset <= header.total_size &&
+         saved.capacity <= header.total_size - saved.storage_offset;
+}
+
+// Settings the engine can run with, push_tx_byte() shifts a uint8_t by
+// data_bits and receive_frame() indexes rx_fifo up to rx_fifo_depth
+static bool config_fits(const SNAPSHOT_DEVICE &saved) {
+  return saved.baud_rate != 0 && saved.data_bits >= 1 && saved.data_bits <= 8 && saved.stop_bits >= 1 &&
+         saved.stop_bits <= 2 && saved.start_bits <= 1 && saved.rx_fifo_depth >= 1 &&
+         saved.rx_fifo_depth <= rx_fifo_capacity && saved.rx_threshold >= 1 && saved.rx_threshold <= rx_fifo_capacity;
+}
+
+static void restore_ring(const SNAPSHOT_RING &saved, ext_ring_buffer<uint8_t> &ring, const uint8_t *image) {
+  copy_bytes(ring.storage(), image + saved.storage_offset, saved.capacity);
+  ring.set_indices(saved.head, saved.tail);
+}
+
+bool snapshot_restore(UART_DEVICE *const *devices, uint32_t device_count, UART_BUS *buses, uint32_t bus_count,
+                      const uint8_t *image, uint32_t length) {
+  SNAPSHOT_HEADER header;
+  if (length < sizeof(header)) {
+    return false;
+  }
+  copy_bytes(&header, image, sizeof(header));
+  if (header.magic != snapshot_magic || header.version != snapshot_version || header.total_size > length ||
+      header.device_count != device_count || header.bus_count != bus_count ||
+      header.devices_offset != sizeof(SNAPSHOT_HEADER) ||
+      header.buses_offset != header.devices_offset + device_count * sizeof(SNAPSHOT_DEVICE) ||
+      header.storage_offset != header.buses_offset + bus_count * align8(sizeof(UART_BUS)) ||
+      header.storage_offset > header.total_size) {
+    return false;
+  }
+
+  // Validate every record before touching a device
+  for (uint32_t i = 0; i < device_count; i++) {
+    SNAPSHOT_DEVICE saved;
+    copy_bytes(&saved, image + header.devices_offset + i * sizeof(SNAPSHOT_DEVICE), sizeof(saved));
+    if ((saved.peer != snapshot_no_link && saved.peer >= device_count) ||
+        (saved.bus != snapshot_no_link && (saved.bus >= bus_count || saved.bus_node >= bus_max_nodes)) ||
+        // The engine goes to dev.bus whenever bus_node is set
+        (saved.bus == snapshot_no_link) != (saved.bus_node == bus_no_node) ||
+        saved.state > (uint8_t)DeviceState::RECEIVING_AND_TRANSMITTING || saved.rx_fifo_count > rx_fifo_capacity ||
+        !config_fits(saved) ||
+        !ring_fits(saved.tx_buf, devices[i]->tx_buf, header) || !ring_fits(saved.rx_buf, devices[i]->rx_buf, header)) {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < device_count; i++) {
+    UART_DEVICE &dev = *devices[i];
+    SNAPSHOT_DEVICE saved;
+    copy_bytes(&saved, image + header.devices_offset + i * sizeof(SNAPSHOT_DEVICE), sizeof(saved));
+
+    dev.config.time_step = saved.config_time_step;
+    dev.config.baud_rate = saved.baud_rate;
+    dev.config.data_bits = saved.data_bits;
+    dev.config.stop_bits = saved.stop_bits;
+    dev.config.start_bits = saved.start_bits;
+    dev.calculate_timing();
+    dev.clock = saved.clock;
+    dev.rx_threshold = saved.rx_threshold;
+    dev.rx_fifo_depth = saved.rx_fifo_depth;
+    dev.frame_errors = saved.frame_errors;
+    dev.rx_overruns = saved.rx_overruns;
+    dev.tx_frames = saved.tx_frames;
+    dev.rx_frames = saved.rx_frames;
+    dev.dropped_bits = saved.dropped_bits;
+    dev.ticks = saved.ticks;
+    dev.state = (DeviceState)saved.state;
+    dev.bus_node = saved.bus_node;
+    dev.event_mask = saved.event_mask;
+    dev.tx_serial_connection = saved.peer != snapshot_no_link ? &devices[saved.peer]->rx_buf : nullptr;
+    dev.bus = saved.bus != snapshot_no_link ? &buses[saved.bus] : nullptr;
+    restore_ring(saved.tx_buf, dev.tx_buf, image);
+    restore_ring(saved.rx_buf, dev.rx_buf, image);
+
+    dev.rx_fifo.reset();
+    for (uint32_t j = 0; j < saved.rx_fifo_count; j++) {
+      dev.rx_fifo.push(saved.rx_fifo[j]);
+    }
+    if (dev.latency != nullptr) {
+      latency_clear_tags(*dev.latency);
+    }
+  }
+  for (uint32_t i = 0; i < bus_count; i++) {
+    copy_bytes(&buses[i], image + header.buses_offset + i * align8(sizeof(UART_BUS)), sizeof(UART_BUS));
+  }
+  return true;
+}
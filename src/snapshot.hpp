@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include "device.hpp"
+#include "bus.hpp"
+
+// Checkpoint of a set of devices and the buses they sit on, as one flat
+// image with no pointers in it: peers and buses are stored as indices into
+// the arrays passed in, so the image can be written to disk, mmap'd back and
+// restored into the same arrays in another run. Records, doubles and UART_BUS
+// are copied as they sit in memory, so the image is native endian and only
+// restores on a build with the same ABI.
+//
+// Image layout, every section 8 byte aligned:
+//   SNAPSHOT_HEADER
+//   SNAPSHOT_DEVICE[device_count]
+//   UART_BUS bytes[bus_count]
+//   tx_buf/rx_buf storage, raw, so head and tail restore as they were
+//
+// Event handlers, their contexts and latency trackers are not part of the
+// image, the devices restored into keep their own. Latency tags in flight
+// are dropped on restore since they belong to characters the rewind
+// replaced; restored characters are simply not measured.
+constexpr uint32_t snapshot_magic = 0x50534155; // "UASP"
+constexpr uint32_t snapshot_version = 3;
+constexpr uint32_t snapshot_no_link = 0xFFFFFFFF;
+
+struct SNAPSHOT_HEADER {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t total_size;
+  uint32_t device_count;
+  uint32_t bus_count;
+  uint32_t devices_offset;
+  uint32_t buses_offset;
+  uint32_t storage_offset;
+};
+
+struct SNAPSHOT_RING {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t capacity;
+  uint32_t storage_offset;  // From the start of the image
+};
+
+struct SNAPSHOT_DEVICE {
+  double clock;
+  double time_per_byte;
+  double config_time_step;
+  uint32_t baud_rate;
+  uint32_t data_bits;
+  uint32_t stop_bits;
+  uint32_t start_bits;
+  uint32_t bits_per_frame;
+  uint32_t rx_threshold;
+  uint32_t rx_fifo_depth;
+  uint32_t frame_errors;
+  uint32_t rx_overruns;
+  uint32_t tx_frames;
+  uint32_t rx_frames;
+  uint32_t dropped_bits;
+  uint32_t ticks;      // tick_down() count, latency tags are relative to it
+  uint32_t peer;       // Index of the device whose rx_buf we drive
+  uint32_t bus;        // Index of the bus we are attached to
+  uint8_t state;
+  uint8_t bus_node;
+  uint8_t event_mask;
+  uint8_t rx_fifo_count;
+  SNAPSHOT_RING tx_buf;
+  SNAPSHOT_RING rx_buf;
+  uint8_t rx_fifo[rx_fifo_capacity];  // Oldest first
+};
+
+static_assert(sizeof(SNAPSHOT_HEADER) % 8 == 0, "Sections must stay 8 byte aligned.");
+static_assert(sizeof(SNAPSHOT_DEVICE) % 8 == 0, "Sections must stay 8 byte aligned.");
+
+// Bytes needed for an image of these devices, storage included
+uint32_t snapshot_size(const UART_DEVICE *const *devices, uint32_t device_count, uint32_t bus_count);
+
+// Returns bytes written, 0 if out is too small or a device is wired to
+// something outside the given arrays
+uint32_t snapshot_save(const UART_DEVICE *const *devices, uint32_t device_count, const UART_BUS *buses,
+                       uint32_t bus_count, uint8_t *out, uint32_t out_capacity);
+
+// Devices must already have storage of the saved capacities attached. The
+// image is checked in full before anything is written, a bad image leaves the
+// devices untouched. Line settings out of range are rejected, and
+// time_per_byte and bits_per_frame are recomputed from them rather than
+// trusted; the saved clock is kept.
+bool snapshot_restore(UART_DEVICE *const *devices, uint32_t device_count, UART_BUS *buses, uint32_t bus_count,
+                      const uint8_t *image, uint32_t length);
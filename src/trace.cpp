@@ -0,0 +1,195 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// One per emitting thread. The thread is the only writer of head and the
+// flusher the only writer of tail, so neither side takes a lock. Buffers are
+// kept for the life of the process so a thread exiting never races a drain.
+struct TRACE_BUFFER {
+  alignas(64) std::atomic<uint32_t> head{0};
+  alignas(64) std::atomic<uint32_t> tail{0};
+  TRACE_BUFFER *next = nullptr;
+  TRACE_EVENT events[trace_buffer_capacity];
+};
+
+static std::atomic<TRACE_BUFFER *> trace_buffers{nullptr};
+static thread_local TRACE_BUFFER *local_buffer = nullptr;
+
+static std::atomic<bool> trace_running{false};
+static std::atomic<uint64_t> dropped_events{0};
+// steady_clock nanoseconds at trace_start(). Atomic because a producer that
+// saw the previous trace running can still be reading it during a restart.
+static std::atomic<int64_t> trace_epoch_ns{0};
+
+// Writer state, owned by the flusher thread while tracing
+static std::mutex trace_control;
+static std::thread flusher;
+static std::FILE *trace_file = nullptr;
+static bool first_record = true;
+static std::unordered_map<const void *, uint32_t> tracks;
+
+static TRACE_BUFFER *thread_buffer() {
+  if (local_buffer == nullptr) {
+    TRACE_BUFFER *buffer = new TRACE_BUFFER;
+    buffer->next = trace_buffers.load(std::memory_order_relaxed);
+    while (!trace_buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+    }
+    local_buffer = buffer;
+  }
+  return local_buffer;
+}
+
+static int64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void emit(const void *source, const char *name, uint32_t value, TraceEventType type) {
+  // Pairs with the release in trace_start(), the epoch it published is visible
+  if (!trace_running.load(std::memory_order_acquire)) {
+    return;
+  }
+  TRACE_BUFFER &buffer = *thread_buffer();
+  uint32_t head = buffer.head.load(std::memory_order_relaxed);
+  if (head - buffer.tail.load(std::memory_order_acquire) == trace_buffer_capacity) {
+    dropped_events.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // A producer racing a restart can read a newer epoch than its clock
+  int64_t elapsed_ns = steady_ns() - trace_epoch_ns.load(std::memory_order_relaxed);
+  uint64_t time_ns = elapsed_ns > 0 ? (uint64_t)elapsed_ns : 0;
+  buffer.events[head & (trace_buffer_capacity - 1)] = TRACE_EVENT{time_ns, source, name, value, type};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void trace_begin(const void *source, const char *name, uint32_t value) {
+  emit(source, name, value, TraceEventType::BEGIN);
+}
+
+void trace_end(const void *source, const char *name, uint32_t value) { emit(source, name, value, TraceEventType::END); }
+
+void trace_instant(const void *source, const char *name, uint32_t value) {
+  emit(source, name, value, TraceEventType::INSTANT);
+}
+
+void trace_name(const void *source, const char *name) { emit(source, name, 0, TraceEventType::NAME); }
+
+uint64_t trace_dropped() { return dropped_events.load(std::memory_order_relaxed); }
+
+static void write_string(const char *text) {
+  std::fputc('"', trace_file);
+  for (; *text != '\0'; text++) {
+    if (*text == '"' || *text == '\\') {
+      std::fputc('\\', trace_file);
+    }
+    std::fputc((unsigned char)*text < 0x20 ? ' ' : *text, trace_file);
+  }
+  std::fputc('"', trace_file);
+}
+
+static void begin_record() {
+  std::fputs(first_record ? "\n" : ",\n", trace_file);
+  first_record = false;
+}
+
+static void write_track_name(uint32_t track, const char *name) {
+  begin_record();
+  std::fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", track);
+  write_string(name);
+  std::fputs("}}", trace_file);
+}
+
+// Sources get a track the first time they show up, labelled by address
+// until a NAME event says otherwise
+static uint32_t track_of(const void *source) {
+  auto found = tracks.find(source);
+  if (found != tracks.end()) {
+    return found->second;
+  }
+  uint32_t track = (uint32_t)tracks.size() + 1;
+  tracks.emplace(source, track);
+  char label[32];
+  std::snprintf(label, sizeof(label), "uart %p", source);
+  write_track_name(track, label);
+  return track;
+}
+
+static void write_event(const TRACE_EVENT &event) {
+  uint32_t track = track_of(event.source);
+  if (event.type == TraceEventType::NAME) {
+    write_track_name(track, event.name);
+    return;
+  }
+  const char *phase = event.type == TraceEventType::BEGIN ? "B" : event.type == TraceEventType::END ? "E" : "i";
+  begin_record();
+  std::fputs("{\"name\":", trace_file);
+  write_string(event.name);
+  std::fprintf(trace_file, ",\"ph\":\"%s\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u", phase,
+               (unsigned long long)(event.time_ns / 1000), (unsigned)(event.time_ns % 1000), track);
+  if (event.type == TraceEventType::INSTANT) {
+    std::fputs(",\"s\":\"t\"", trace_file);
+  }
+  std::fprintf(trace_file, ",\"args\":{\"value\":%u}}", event.value);
+}
+
+static void drain_buffers() {
+  for (TRACE_BUFFER *buffer = trace_buffers.load(std::memory_order_acquire); buffer != nullptr;
+       buffer = buffer->next) {
+    uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+    uint32_t head = buffer->head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+      write_event(buffer->events[tail & (trace_buffer_capacity - 1)]);
+    }
+    buffer->tail.store(tail, std::memory_order_release);
+  }
+}
+
+static void flush_loop() {
+  while (trace_running.load(std::memory_order_acquire)) {
+    drain_buffers();
+    std::this_thread::sleep_for(std::chrono::microseconds(trace_flush_interval_us));
+  }
+}
+
+bool trace_start(const char *path) {
+  std::lock_guard<std::mutex> lock(trace_control);
+  if (trace_file != nullptr) {
+    return false;
+  }
+  trace_file = std::fopen(path, "w");
+  if (trace_file == nullptr) {
+    return false;
+  }
+  // Anything a thread emitted while the last trace was stopping is stale
+  for (TRACE_BUFFER *buffer = trace_buffers.load(std::memory_order_acquire); buffer != nullptr;
+       buffer = buffer->next) {
+    buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+  std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", trace_file);
+  first_record = true;
+  tracks.clear();
+  dropped_events.store(0, std::memory_order_relaxed);
+  trace_epoch_ns.store(steady_ns(), std::memory_order_relaxed);
+  trace_running.store(true, std::memory_order_release);
+  flusher = std::thread(flush_loop);
+  return true;
+}
+
+void trace_stop() {
+  std::lock_guard<std::mutex> lock(trace_control);
+  if (trace_file == nullptr) {
+    return;
+  }
+  trace_running.store(false, std::memory_order_release);
+  flusher.join();
+  drain_buffers();
+  std::fputs("\n]}\n", trace_file);
+  std::fclose(trace_file);
+  trace_file = nullptr;
+}
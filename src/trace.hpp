@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+
+// Timeline tracing in Chrome trace event format (chrome://tracing, Perfetto
+// UI). Each traced source, usually a device, gets its own track; state and
+// frame spans nest on it and errors show as instants.
+//
+// Emitting appends to a per thread single producer ring without locks, a
+// background thread drains every ring to the file. A full ring drops the
+// event and counts it rather than stall the simulation.
+//
+// The engine hooks below expand to nothing unless built with UART_TRACE=1
+// (make TRACE=1), and the writer itself is hosted only.
+constexpr uint32_t trace_buffer_capacity = 8192;  // Events per thread, power of two
+constexpr uint32_t trace_flush_interval_us = 1000;
+
+static_assert((trace_buffer_capacity & (trace_buffer_capacity - 1)) == 0,
+              "trace_buffer_capacity must be a power of two.");
+
+enum class TraceEventType : uint8_t {
+  BEGIN,
+  END,
+  INSTANT,
+  NAME,   // Track label, name must outlive trace_stop()
+};
+
+struct TRACE_EVENT {
+  uint64_t time_ns;
+  const void *source;
+  const char *name;     // String literal or otherwise static
+  uint32_t value;
+  TraceEventType type;
+};
+
+// Starts the background writer, false if already running or the file cannot
+// be opened. Stop drains what is left and closes the JSON document.
+bool trace_start(const char *path);
+void trace_stop();
+
+void trace_begin(const void *source, const char *name, uint32_t value);
+void trace_end(const void *source, const char *name, uint32_t value);
+void trace_instant(const void *source, const char *name, uint32_t value);
+void trace_name(const void *source, const char *name);
+
+// Events lost to full rings since trace_start()
+[[nodiscard]] uint64_t trace_dropped();
+
+#if UART_TRACE
+#define UART_TRACE_BEGIN(source, name, value) trace_begin(source, name, value)
+#define UART_TRACE_END(source, name, value) trace_end(source, name, value)
+#define UART_TRACE_INSTANT(source, name, value) trace_instant(source, name, value)
+#else
+#define UART_TRACE_BEGIN(source, name, value) ((void)0)
+#define UART_TRACE_END(source, name, value) ((void)0)
+#define UART_TRACE_INSTANT(source, name, value) ((void)0)
+#endif
@@ -0,0 +1,220 @@
+#include "uart_16550.hpp"
+
+// 16 byte trigger levels, scaled for other FIFO depths
+constexpr uint8_t rx_trigger_levels[4] = {1, 4, 8, 14};
+
+static bool fifo_enabled(const UART_16550 &uart) { return (uart.fcr & fcr_enable) != 0; }
+
+static uint32_t tx_chars_queued(const UART_16550 &uart) {
+  return uart.dev->tx_buf.count() / uart.dev->config.data_bits;
+}
+
+static uint8_t pending_interrupt(const UART_16550 &uart) {
+  const UART_DEVICE &dev = *uart.dev;
+  if ((uart.ier & ier_line_status) && uart.lsr_errors != 0) {
+    return iir_line_status;
+  }
+  if (uart.ier & ier_rx_data) {
+    if (dev.rx_fifo.count() >= uart.rx_trigger) {
+      return iir_rx_data;
+    }
+    if (fifo_enabled(uart) && !dev.rx_fifo.is_empty() && uart.idle_chars >= uart16550_timeout_chars) {
+      return iir_char_timeout;
+    }
+  }
+  if ((uart.ier & ier_thr_empty) && uart.thre_pending) {
+    return iir_thr_empty;
+  }
+  return iir_no_interrupt;
+}
+
+static void apply_line_settings(UART_16550 &uart) {
+  UART_DEVICE &dev = *uart.dev;
+  dev.config.start_bits = 1;
+  dev.config.data_bits = 5 + (uart.lcr & lcr_word_length);
+  dev.config.stop_bits = (uart.lcr & lcr_two_stop_bits) ? 2 : 1;
+  dev.config.baud_rate = uart16550_clock_baud / (uart.divisor != 0 ? uart.divisor : 1);
+  dev.calculate_timing();
+}
+
+static void apply_fifo_control(UART_16550 &uart, uint8_t value) {
+  UART_DEVICE &dev = *uart.dev;
+  uart.fcr = value;
+  if (value & fcr_clear_rx) {
+    dev.rx_fifo.reset();
+  }
+  if (value & fcr_clear_tx) {
+    dev.tx_buf.reset();
+  }
+
+  if (!fifo_enabled(uart)) {
+    // 16450 mode, single holding register
+    dev.rx_fifo_depth = 1;
+    uart.rx_trigger = 1;
+    return;
+  }
+  dev.rx_fifo_depth = uart.fifo_depth;
+  uint32_t trigger = rx_trigger_levels[value >> fcr_trigger_shift] * uart.fifo_depth / uart16550_fifo_depth;
+  uart.rx_trigger = trigger != 0 ? trigger : 1;
+}
+
+static void on_device_event(UART_DEVICE &dev, UartEvent event, void *ctx) {
+  (void)dev;
+  UART_16550 &uart = *static_cast<UART_16550 *>(ctx);
+  switch (event) {
+    case UartEvent::RX_READY:
+      uart.idle_chars = 0;
+      break;
+    case UartEvent::TX_EMPTY:
+      uart.thre_pending = true;
+      break;
+    case UartEvent::FRAME_ERROR:
+      uart.lsr_errors |= lsr_framing;
+      break;
+    case UartEvent::OVERRUN_ERROR:
+      uart.lsr_errors |= lsr_overrun;
+      break;
+    default:
+      break;
+  }
+}
+
+void uart16550_attach(UART_16550 &uart, UART_DEVICE &dev, uint32_t fifo_depth) {
+  uart = UART_16550{};
+  uart.dev = &dev;
+  uart.fifo_depth = fifo_depth < rx_fifo_capacity ? fifo_depth : rx_fifo_capacity;
+  uart.thre_pending = dev.tx_buf.is_empty();
+  set_event_handler(dev, (uint8_t)UartEvent::RX_READY | (uint8_t)UartEvent::TX_EMPTY | uart_events_errors,
+                    on_device_event, &uart);
+  apply_fifo_control(uart, 0);
+  apply_line_settings(uart);
+}
+
+uint8_t uart16550_read(UART_16550 &uart, Reg16550 reg) {
+  UART_DEVICE &dev = *uart.dev;
+  bool dlab = (uart.lcr & lcr_dlab) != 0;
+
+  switch (reg) {
+    case Reg16550::RBR_THR: {
+      if (dlab) {
+        return (uint8_t)(uart.divisor & 0xFF);
+      }
+      uint8_t value = 0;
+      dev.rx_fifo.pop(value);
+      uart.idle_chars = 0;
+      return value;
+    }
+    case Reg16550::IER:
+      return dlab ? (uint8_t)(uart.divisor >> 8) : uart.ier;
+    case Reg16550::IIR_FCR: {
+      uint8_t iir = pending_interrupt(uart);
+      if (iir == iir_thr_empty) {
+        // Reading IIR acknowledges a THR empty interrupt
+        uart.thre_pending = false;
+      }
+      return iir | (fifo_enabled(uart) ? iir_fifo_enabled : 0);
+    }
+    case Reg16550::LCR:
+      return uart.lcr;
+    case Reg16550::MCR:
+      return uart.mcr;
+    case Reg16550::LSR: {
+      uint8_t lsr = uart.lsr_errors;
+      if (!dev.rx_fifo.is_empty()) {
+        lsr |= lsr_data_ready;
+      }
+      if (tx_chars_queued(uart) == 0) {
+        // Frames leave the shift register whole, so THRE and TEMT move together
+        lsr |= lsr_thr_empty | lsr_tx_empty;
+      }
+      if (fifo_enabled(uart) && (uart.lsr_errors & (lsr_parity | lsr_framing | lsr_break))) {
+        lsr |= lsr_fifo_error;
+      }
+      uart.lsr_errors = 0;
+      return lsr;
+    }
+    case Reg16550::MSR:
+      return msr_connected;
+    case Reg16550::SCR:
+      return uart.scr;
+  }
+  return 0xFF;
+}
+
+void uart16550_write(UART_16550 &uart, Reg16550 reg, uint8_t value) {
+  UART_DEVICE &dev = *uart.dev;
+  bool dlab = (uart.lcr & lcr_dlab) != 0;
+
+  switch (reg) {
+    case Reg16550::RBR_THR:
+      if (dlab) {
+        uart.divisor = (uint16_t)((uart.divisor & 0xFF00) | value);
+        apply_line_settings(uart);
+        return;
+      }
+      uart.thre_pending = false;
+      if (tx_chars_queued(uart) < (fifo_enabled(uart) ? uart.fifo_depth : 1)) {
+        push_tx_byte(dev, value);
+      }
+      return;
+    case Reg16550::IER:
+      if (dlab) {
+        uart.divisor = (uint16_t)((uart.divisor & 0x00FF) | (value << 8));
+        apply_line_settings(uart);
+        return;
+      }
+      if ((value & ier_thr_empty) && !(uart.ier & ier_thr_empty) && tx_chars_queued(uart) == 0) {
+        // Enabling ETBEI with an empty THR raises the interrupt straight away
+        uart.thre_pending = true;
+      }
+      uart.ier = value & 0x0F;
+      return;
+    case Reg16550::IIR_FCR:
+      apply_fifo_control(uart, value);
+      return;
+    case Reg16550::LCR:
+      uart.lcr = value;
+      apply_line_settings(uart);
+      return;
+    case Reg16550::MCR:
+      uart.mcr = value & 0x1F;
+      return;
+    case Reg16550::SCR:
+      uart.scr = value;
+      return;
+    default:
+      // LSR and MSR are read only
+      return;
+  }
+}
+
+uint32_t uart16550_read_burst(UART_16550 &uart, uint8_t *out, uint32_t max_count) {
+  uint32_t read_count = read_rx_fifo(*uart.dev, out, max_count);
+  if (read_count != 0) {
+    uart.idle_chars = 0;
+  }
+  return read_count;
+}
+
+uint32_t uart16550_write_burst(UART_16550 &uart, const uint8_t *data, uint32_t count) {
+  uint32_t depth = fifo_enabled(uart) ? uart.fifo_depth : 1;
+  uint32_t queued = tx_chars_queued(uart);
+  uint32_t written = 0;
+  while (written < count && queued + written < depth && push_tx_byte(*uart.dev, data[written])) {
+    written++;
+  }
+  if (written != 0) {
+    uart.thre_pending = false;
+  }
+  return written;
+}
+
+void uart16550_service(UART_16550 &uart) {
+  if (is_ready(*uart.dev)) {
+    // One character time passes per device period
+    uart.idle_chars++;
+  }
+  service_device(*uart.dev);
+}
+
+bool uart16550_irq(const UART_16550 &uart) { return pending_interrupt(uart) != iir_no_interrupt; }
@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include "device.hpp"
+
+// Register level 16550 front end over a UART_DEVICE. Offsets follow the PC
+// layout so driver code can be pointed at uart16550_read/uart16550_write in
+// place of its inb/outb accessors.
+enum class Reg16550 : uint8_t {
+  RBR_THR = 0, // DLL when LCR.DLAB is set
+  IER = 1,     // DLM when LCR.DLAB is set
+  IIR_FCR = 2,
+  LCR = 3,
+  MCR = 4,
+  LSR = 5,
+  MSR = 6,
+  SCR = 7,
+};
+
+// IER
+constexpr uint8_t ier_rx_data = 0x01;
+constexpr uint8_t ier_thr_empty = 0x02;
+constexpr uint8_t ier_line_status = 0x04;
+constexpr uint8_t ier_modem_status = 0x08;
+
+// IIR, bit 0 clear means an interrupt is pending
+constexpr uint8_t iir_no_interrupt = 0x01;
+constexpr uint8_t iir_modem_status = 0x00;
+constexpr uint8_t iir_thr_empty = 0x02;
+constexpr uint8_t iir_rx_data = 0x04;
+constexpr uint8_t iir_line_status = 0x06;
+constexpr uint8_t iir_char_timeout = 0x0C;
+constexpr uint8_t iir_fifo_enabled = 0xC0;
+
+// FCR
+constexpr uint8_t fcr_enable = 0x01;
+constexpr uint8_t fcr_clear_rx = 0x02;
+constexpr uint8_t fcr_clear_tx = 0x04;
+constexpr uint8_t fcr_trigger_shift = 6;
+
+// LCR
+constexpr uint8_t lcr_word_length = 0x03;
+constexpr uint8_t lcr_two_stop_bits = 0x04;
+constexpr uint8_t lcr_dlab = 0x80;
+
+// LSR
+constexpr uint8_t lsr_data_ready = 0x01;
+constexpr uint8_t lsr_overrun = 0x02;
+constexpr uint8_t lsr_parity = 0x04;
+constexpr uint8_t lsr_framing = 0x08;
+constexpr uint8_t lsr_break = 0x10;
+constexpr uint8_t lsr_thr_empty = 0x20;
+constexpr uint8_t lsr_tx_empty = 0x40;
+constexpr uint8_t lsr_fifo_error = 0x80;
+
+// MSR, the line is modelled as always connected
+constexpr uint8_t msr_connected = 0xB0; // CTS | DSR | DCD
+
+constexpr uint32_t uart16550_clock_baud = 115200; // 1.8432 MHz / 16
+constexpr uint32_t uart16550_fifo_depth = 16;
+constexpr uint32_t uart16550_timeout_chars = 4;
+
+struct UART_16550 {
+  UART_DEVICE* dev = nullptr;
+  uint8_t ier = 0;
+  uint8_t lcr = 0x03;           // 8N1
+  uint8_t mcr = 0;
+  uint8_t scr = 0;
+  uint8_t fcr = 0;
+  uint8_t lsr_errors = 0;       // Sticky OE/FE, cleared by reading LSR
+  uint16_t divisor = 1;
+  uint32_t fifo_depth = uart16550_fifo_depth;
+  uint32_t rx_trigger = 1;
+  uint32_t idle_chars = 0;      // Character times since the RX FIFO was last touched
+  bool thre_pending = false;    // THR empty interrupt, cleared by IIR read or THR write
+};
+
+// Takes over the device's event handler and resets it to 8N1 at 115200 baud.
+// fifo_depth is clamped to rx_fifo_capacity.
+void uart16550_attach(UART_16550 &uart, UART_DEVICE &dev, uint32_t fifo_depth = uart16550_fifo_depth);
+
+uint8_t uart16550_read(UART_16550 &uart, Reg16550 reg);
+void uart16550_write(UART_16550 &uart, Reg16550 reg, uint8_t value);
+
+// Equivalent to reading RBR while LSR.DR is set, without the per byte dispatch
+uint32_t uart16550_read_burst(UART_16550 &uart, uint8_t *out, uint32_t max_count);
+uint32_t uart16550_write_burst(UART_16550 &uart, const uint8_t *data, uint32_t count);
+
+// Runs one service_device() step and keeps the character timeout counter
+void uart16550_service(UART_16550 &uart);
+[[nodiscard]] bool uart16550_irq(const UART_16550 &uart);
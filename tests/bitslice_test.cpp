@@ -0,0 +1,268 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/bitslice.hpp"
+
+constexpr uint32_t max_periods = 100000;
+
+static BITSLICE_LINKS links;
+
+static std::string link_message(uint32_t link) {
+  return "link " + std::to_string(link) + std::string(link % 7, '*');
+}
+
+static void run_until_idle(BITSLICE_LINKS &group) {
+  uint32_t periods = 0;
+  while (!bitslice_idle(group) && periods++ < max_periods) {
+    bitslice_step(group);
+  }
+  assert(bitslice_idle(group));
+}
+
+static std::string drain(BITSLICE_LINKS &group, uint32_t link) {
+  std::string received;
+  uint8_t value = 0;
+  while (bitslice_pop(group, link, value)) {
+    received += (char)value;
+  }
+  return received;
+}
+
+// Every link carries its own text, all 64 advance together
+bool test_bitslice_64_links() {
+  assert(bitslice_init(links, bitslice_links, 8, 1));
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    for (char character : link_message(link)) {
+      assert(bitslice_push(links, link, (uint8_t)character));
+    }
+  }
+  run_until_idle(links);
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    std::string expected = link_message(link);
+    assert(drain(links, link) == expected);
+    assert(bitslice_tx_frames(links, link) == expected.size() && bitslice_rx_frames(links, link) == expected.size());
+    assert(links.frame_errors[link] == 0);
+  }
+  return true;
+}
+
+// Links start at different periods so their frames are out of phase, with a
+// 7E2 format and values that exercise every data plane
+bool test_bitslice_staggered_7e2() {
+  assert(bitslice_init(links, 40, 7, 2));
+  std::vector<std::string> expected(40);
+  for (uint32_t period = 0; period < 400; period++) {
+    uint32_t link = period % 40;
+    if (period / 40 < 3) {
+      uint8_t value = (uint8_t)((period * 37 + link) & 0x7F);
+      assert(bitslice_push(links, link, value));
+      expected[link] += (char)value;
+    }
+    bitslice_step(links);
+  }
+  run_until_idle(links);
+  for (uint32_t link = 0; link < 40; link++) {
+    assert(drain(links, link) == expected[link]);
+  }
+  // Links past link_count never run, pushes to them are refused
+  assert(!bitslice_push(links, 64, 0x01));
+  assert(!bitslice_push(links, 40, 0x01) && links.tx_queue[40].is_empty() && bitslice_idle(links));
+  assert(bitslice_tx_frames(links, 40) == 0 && bitslice_rx_frames(links, 40) == 0);
+  return true;
+}
+
+// Noise on one link's stop bit is a framing error on that link alone, and its
+// receiver resyncs on the next start bit
+bool test_bitslice_frame_error() {
+  assert(bitslice_init(links, bitslice_links, 8, 1));
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    assert(bitslice_push(links, link, 0x55));
+  }
+  // Period 9 is the first frame's stop bit
+  for (uint32_t period = 0; period < 10; period++) {
+    bitslice_step(links, period == 9 ? (1ull << 5) : 0);
+  }
+  run_until_idle(links);
+  // One idle high period, so the next start bit is a falling edge again
+  bitslice_step(links);
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    assert(bitslice_push(links, link, 0x3C));
+  }
+  run_until_idle(links);
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    std::string received = drain(links, link);
+    if (link == 5) {
+      assert(links.frame_errors[link] == 1 && received == "\x3C");
+    } else {
+      assert(links.frame_errors[link] == 0 && received == "\x55\x3C");
+    }
+  }
+  return true;
+}
+
+// A line held low from a bad stop bit into idle has no falling edge, the
+// receiver waits for the line to go high and drop again
+bool test_bitslice_held_low() {
+  assert(bitslice_init(links, bitslice_links, 8, 1));
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    assert(bitslice_push(links, link, 0x55));
+  }
+  // Period 9 is the stop bit, period 10 the idle line after it
+  for (uint32_t period = 0; period < 11; period++) {
+    bitslice_step(links, period >= 9 ? (1ull << 9) : 0);
+    if (period == 10) {
+      assert((links.rx_next[1] & (1ull << 9)) == 0);
+    }
+  }
+  run_until_idle(links);
+  bitslice_step(links);
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    assert(bitslice_push(links, link, 0xA7));
+  }
+  run_until_idle(links);
+
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    std::string received = drain(links, link);
+    if (link == 9) {
+      assert(links.frame_errors[link] == 1 && bitslice_rx_frames(links, link) == 1 && received == "\xA7");
+    } else {
+      assert(links.frame_errors[link] == 0 && received == "\x55\xA7");
+    }
+  }
+  return true;
+}
+
+// Lockstep fleet with bytes kept in word form, a receive skipped for one
+// frame is an overrun on every link that completed twice
+bool test_bitslice_direct() {
+  assert(bitslice_init(links, bitslice_links, 8, 1));
+  bitslice_set_direct(links, true);
+  uint8_t sent[bitslice_links];
+  uint8_t received[bitslice_links];
+  for (uint32_t round = 0; round < 3; round++) {
+    for (uint32_t link = 0; link < bitslice_links; link++) {
+      sent[link] = (uint8_t)(round * 91 + link * 3);
+    }
+    assert(bitslice_send(links, sent, ~0ull) == ~0ull);
+    // The line is still busy with the last frame
+    assert(bitslice_send(links, sent, ~0ull) == 0);
+    bitslice_step_n(links, links.frame_bits);
+    if (round == 1) {
+      continue;
+    }
+    assert(bitslice_receive(links, received) == ~0ull);
+    for (uint32_t link = 0; link < bitslice_links; link++) {
+      assert(received[link] == sent[link]);
+    }
+  }
+  assert(bitslice_receive(links, received) == 0);
+  for (uint32_t link = 0; link < bitslice_links; link++) {
+    assert(links.rx_overruns[link] == 1 && bitslice_rx_frames(links, link) == 3);
+    assert(links.tx_queue[link].is_empty() && links.rx_queue[link].is_empty());
+  }
+  return true;
+}
+
+// Per link devices in, bit-sliced run, per link devices out
+bool test_bitslice_device_round_trip() {
+  constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+    .data_bits = 8,
+    .stop_bits = 1,
+    .start_bits = 1, };
+  constexpr uint32_t link_count = 16;
+  static UART_DEVICE senders[link_count];
+  static UART_DEVICE receivers[link_count];
+  static uint8_t storage[link_count * 4][buf_capacity_large];
+  UART_DEVICE *sender_ptrs[link_count];
+  UART_DEVICE *receiver_ptrs[link_count];
+  for (uint32_t link = 0; link < link_count; link++) {
+    senders[link] = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    receivers[link] = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    attach_buffers(senders[link], storage[link * 4], storage[link * 4 + 1]);
+    attach_buffers(receivers[link], storage[link * 4 + 2], storage[link * 4 + 3]);
+    serial_connection(senders[link], receivers[link]);
+    sender_ptrs[link] = &senders[link];
+    receiver_ptrs[link] = &receivers[link];
+    for (char character : link_message(link)) {
+      assert(push_tx_byte(senders[link], (uint8_t)character));
+    }
+  }
+
+  assert(bitslice_load(links, sender_ptrs, receiver_ptrs, link_count));
+  assert(senders[3].tx_buf.is_empty());
+  // Stop mid frame, the store finishes frames already on the line and hands
+  // the rest back to tx_buf
+  bitslice_step_n(links, 35);
+  bitslice_store(links, sender_ptrs, receiver_ptrs, link_count);
+
+  for (uint32_t link = 0; link < link_count; link++) {
+    std::string expected = link_message(link);
+    std::string received;
+    uint8_t value = 0;
+    while (receivers[link].rx_fifo.pop(value)) {
+      received += (char)value;
+    }
+    assert(received == expected.substr(0, 4));
+    assert(senders[link].tx_frames == 4 && receivers[link].rx_frames == 4);
+    assert(senders[link].tx_buf.count() == (expected.size() - 4) * 8);
+  }
+
+  // A frame still in a receiver's rx_buf, crossed wiring or a bus node
+  // refuses the load and leaves the devices as they were
+  assert(transmit_frame(senders[9]) && !receivers[9].rx_buf.is_empty());
+  assert(!bitslice_load(links, sender_ptrs, receiver_ptrs, link_count));
+  std::swap(receiver_ptrs[0], receiver_ptrs[1]);
+  assert(!bitslice_load(links, sender_ptrs, receiver_ptrs, 2));
+  std::swap(receiver_ptrs[0], receiver_ptrs[1]);
+  senders[1].bus_node = 0;
+  assert(!bitslice_load(links, sender_ptrs, receiver_ptrs, 2));
+  senders[1].bus_node = bus_no_node;
+  assert(senders[1].tx_buf.count() == (link_message(1).size() - 4) * 8);
+
+  // The per device engine picks up where the bit-sliced one stopped
+  std::string rest;
+  for (int tick = 0; tick < 10000; tick++) {
+    service_device(senders[9]);
+    service_device(receivers[9]);
+    uint8_t value = 0;
+    while (receivers[9].rx_fifo.pop(value)) {
+      rest += (char)value;
+    }
+  }
+  return rest == link_message(9).substr(4) && senders[9].tx_frames == link_message(9).size();
+}
+
+int main() {
+  if (test_bitslice_64_links()) {
+    std::cout << "Good: Bit-Sliced 64 Links" << std::endl;
+  }
+
+  if (test_bitslice_staggered_7e2()) {
+    std::cout << "Good: Bit-Sliced Staggered 7E2" << std::endl;
+  }
+
+  if (test_bitslice_frame_error()) {
+    std::cout << "Good: Bit-Sliced Frame Error" << std::endl;
+  }
+
+  if (test_bitslice_held_low()) {
+    std::cout << "Good: Bit-Sliced Held Low Line" << std::endl;
+  }
+
+  if (test_bitslice_direct()) {
+    std::cout << "Good: Bit-Sliced Direct Mode" << std::endl;
+  }
+
+  if (test_bitslice_device_round_trip()) {
+    std::cout << "Good: Bit-Sliced Device Round Trip" << std::endl;
+  } else {
+    std::cout << "Err: Bit-Sliced Device Round Trip" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+#include "../src/device.hpp"
+
+constexpr uint8_t start_bit = 0x00; // low line
+constexpr uint8_t stop_bit = 0x01; // high line
+constexpr uint32_t node_count = 32;
+
+static void send_frame(UART_DEVICE &dev, uint8_t character) {
+  send_bit(dev, start_bit);
+  for (int i = (int)dev.config.data_bits - 1; i >= 0; --i) {
+    send_bit(dev, (character >> i) & 0x01);
+  }
+  send_bit(dev, stop_bit);
+}
+
+static UART_DEVICE nodes[node_count];
+static UART_BUS bus;
+
+static void setup_bus() {
+  constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+    .data_bits = 8,
+    .stop_bits = 1,
+    .start_bits = 1, };
+
+  bus = UART_BUS{};
+  for (uint32_t i = 0; i < node_count; i++) {
+    nodes[i] = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    nodes[i].calculate_timing();
+    assert(serial_bus(bus, nodes[i]));
+    assert(nodes[i].bus_node == i);
+  }
+}
+
+bool test_bus_fan_out() {
+  setup_bus();
+  std::string send_string("RS485");
+
+  assert(bus_enable_driver(bus, 0));
+  for (char character : send_string) {
+    send_frame(nodes[0], (uint8_t)character);
+  }
+  bus_disable_driver(bus, 0);
+
+  // Every bit is written once no matter how many nodes listen
+  assert(bus.write_seq == send_string.size() * nodes[0].bits_per_frame);
+
+  for (uint32_t i = 1; i < node_count; i++) {
+    std::string received;
+    uint8_t character = 0;
+    while (bus_receive_frame(bus, nodes[i], character)) {
+      received += (char)character;
+    }
+    assert(received == send_string);
+    assert(bus_pending(bus, i) == 0);
+  }
+
+  // The driver does not read back its own echo
+  uint8_t character = 0;
+  (void)character;
+  assert(!bus_receive_frame(bus, nodes[0], character));
+  return true;
+}
+
+bool test_bus_driver_enable() {
+  setup_bus();
+  // Without driver enable nothing reaches the line
+  assert(!send_bit(nodes[3], start_bit));
+  assert(bus.write_seq == 0);
+
+  assert(bus_enable_driver(bus, 3));
+  send_frame(nodes[3], 'Z');
+  bus_disable_driver(bus, 3);
+
+  uint8_t character = 0;
+  (void)character;
+  assert(bus_receive_frame(bus, nodes[7], character) && character == 'Z');
+  return true;
+}
+
+bool test_bus_collision() {
+  setup_bus();
+  assert(bus_enable_driver(bus, 1));
+  assert(!bus_enable_driver(bus, 2));
+  assert(bus.collisions == 1);
+
+  // Both drivers asserted, every bit is garbled and reported as failed
+  assert(!send_bit(nodes[1], start_bit));
+  assert(bus.collisions == 2);
+
+  uint8_t character = 0;
+  (void)character;
+  assert(!bus_receive_frame(bus, nodes[5], character));
+  assert(bus_pending(bus, 5) == 0);
+
+  bus_disable_driver(bus, 2);
+  send_frame(nodes[1], 'A');
+  assert(bus_receive_frame(bus, nodes[5], character) && character == 'A');
+  return true;
+}
+
+bool test_bus_overrun() {
+  setup_bus();
+  assert(bus_enable_driver(bus, 0));
+  uint32_t frames = (bus_capacity / nodes[0].bits_per_frame) + 4;
+  for (uint32_t i = 0; i < frames; i++) {
+    send_frame(nodes[0], 'x');
+  }
+
+  // A reader that never drained has lost the oldest bits
+  uint8_t character = 0;
+  (void)character;
+  bus_receive_frame(bus, nodes[9], character);
+  assert(bus.overruns == 1);
+  assert(bus_pending(bus, 9) <= bus_capacity);
+  return true;
+}
+
+int main() {
+  if (test_bus_fan_out()) {
+    std::cout << "Good: Bus Fan Out (" << node_count << " nodes)" << std::endl;
+  }
+
+  if (test_bus_driver_enable()) {
+    std::cout << "Good: Bus Driver Enable" << std::endl;
+  }
+
+  if (test_bus_collision()) {
+    std::cout << "Good: Bus Collision Detection" << std::endl;
+  }
+
+  if (test_bus_overrun()) {
+    std::cout << "Good: Bus Reader Overrun" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
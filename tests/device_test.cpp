@@ -1,116 +1,15 @@
 #include <cstdint>
 #include <iostream>
 #include <cstdlib>
+#include <cassert>
 #include <string>
 #include <memory>
 #include <algorithm>
 
 #include "../src/device.hpp"
 
-constexpr uint8_t start_bit = 0x00; // low line
-constexpr uint8_t stop_bit = 0x01; // high line
-
 constexpr uint32_t discrete_time_step = 1;
 
-static void load_bit_array_tx(UART_DEVICE &dev, const uint8_t *bit_arr, uint32_t size) {
-  for (uint32_t binary_iterator = 0; binary_iterator < size; binary_iterator++) {
-   dev.tx_buf.push(bit_arr[binary_iterator]);
-  }
-}
-
-static void transition_uart_state(UART_DEVICE &dev) {
-    // This function updates the UART device state based on its buffer status.
-    if (!dev.rx_buf.is_empty()) { // Receiving
-        if (dev.state == DeviceState::TRANSMITTING) {
-            dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-        } else {
-            dev.state = DeviceState::RECEIVING;
-        }
-    }
-
-    if (!dev.tx_buf.is_empty()) { // Transmitting
-        if (dev.state == DeviceState::RECEIVING) {
-            dev.state = DeviceState::RECEIVING_AND_TRANSMITTING;
-        } else {
-            dev.state = DeviceState::TRANSMITTING;
-        }
-    }
-}
-
-static void handle_receive(UART_DEVICE &dev, uint8_t &reconstructed_character) {
-  if (dev.state == DeviceState::RECEIVING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-    // Reset for new frame
-    reconstructed_character = 0x00;
-    
-    // Need to parse one message from rx_buf
-    uint8_t message_start = 0;
-    uint8_t message_end = 0;
-
-    dev.rx_buf.peek(message_start);
-
-    if (message_start == start_bit) {
-      uint8_t message_start_value = 0;
-      uint8_t message_data_value = 0;
-    
-      dev.rx_buf.pop(message_start_value);
-    
-      for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
-        dev.rx_buf.pop(message_data_value);
-    
-        reconstructed_character = reconstructed_character << 1;
-        reconstructed_character |= message_data_value;
-      }
-      
-      // Move stop bit logic inside the start bit check
-      dev.rx_buf.peek(message_end);
-      if (message_end == stop_bit) {
-        dev.rx_buf.pop(message_end);
-        dev.state = DeviceState::IDLE;
-      } else {
-        // Bad frame
-        dev.rx_buf.reset();
-        dev.state = DeviceState::IDLE;
-      }
-    } else {
-      // Invalid start bit - skip this frame
-      dev.rx_buf.reset();
-      dev.state = DeviceState::IDLE;
-    }
-  }
-}
-
-static void handle_transmit(UART_DEVICE &dev) {
-  if (dev.state == DeviceState::TRANSMITTING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-    send_bit(dev, start_bit);
-    uint8_t send_value = 0;
-
-    for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
-      dev.tx_buf.pop(send_value);
-      send_bit(dev, send_value);
-    }
-    send_bit(dev, stop_bit);
-
-    dev.state = DeviceState::IDLE;
-  }
-}
-
-static uint32_t handle_transmit_with_overflow_detection(UART_DEVICE &dev, uint32_t &bits_lost) {
-  uint32_t overflow_count = 0;
-  if (dev.state == DeviceState::TRANSMITTING || dev.state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-    if (!send_bit(dev, start_bit)) { overflow_count++; bits_lost++; }
-    uint8_t send_value = 0;
-
-    for (uint32_t data_bits_idx = 0; data_bits_idx < dev.config.data_bits; data_bits_idx++) {
-      dev.tx_buf.pop(send_value);
-      if (!send_bit(dev, send_value)) { overflow_count++; bits_lost++; }
-    }
-    if (!send_bit(dev, stop_bit)) { overflow_count++; bits_lost++; }
-
-    dev.state = DeviceState::IDLE;
-  }
-  return overflow_count;
-}
-
 static std::unique_ptr<uint8_t[]> string_to_bits(std::string str_in) { // Allocates memory
   uint32_t bit_arr_size = str_in.size() * 8;
   std::unique_ptr<uint8_t[]> bit_arr_ptr =
@@ -130,124 +29,95 @@ static std::unique_ptr<uint8_t[]> string_to_bits(std::string str_in) { // Alloca
 
 bool multi_byte_transmission(UART_DEVICE &dev, UART_DEVICE &other) {
   int simulation_time = 100000;
-  bool test_passed = true;
-  constexpr int msg_length = 11;
-
   std::string send_string("Hello World");
   std::unique_ptr<uint8_t[]> bit_arr = string_to_bits(send_string);
-
-  load_bit_array_tx(dev, bit_arr.get(), send_string.size() * 8);
-  uint32_t sent = 0;
-  uint8_t reconstructed_arr[msg_length] = {};
-
-  // for (int i = 0; i < send_string.size() * 8; i++) {
-  //   uint8_t tmp = 0;
-  //   dev.tx_buf.pop(tmp);
-  //   std::cout << static_cast<unsigned int>(tmp) << std::endl;
-  // }
-
-  while (simulation_time > 0 && sent != msg_length) {
-    // Main loop here
-    if (is_ready(dev)) {
-      reset_clock(dev);
-      transition_uart_state(dev);
-
-      //
-      handle_transmit(dev);
-
+  assert(load_bit_array_tx(dev, bit_arr.get(), send_string.size() * 8) == send_string.size() * 8);
+
+  std::string received;
+  while (simulation_time > 0 && received.size() < send_string.size()) {
+    step_device(dev);
+    step_device(other);
+    uint8_t character = 0;
+    while (read_rx_fifo(other, &character, 1) == 1) {
+      received += static_cast<char>(character);
     }
-    if (is_ready(other)) {
-      reset_clock(other);
-      transition_uart_state(other);
+    simulation_time -= discrete_time_step;
+  }
 
-      handle_transmit(other);
-      handle_receive(other, reconstructed_arr[sent]);
-      sent++;
-    }
+  return received == send_string && dev.tx_frames == send_string.size() && other.frame_errors == 0;
+}
 
+// A batched run is the same interleaving as stepping each device in turn
+bool batched_step_matches_single_step() {
+  constexpr UART_CONFIG config = {.baud_rate = 19200,
+    .data_bits = 8,
+    .stop_bits = 1,
+    .start_bits = 1, };
+  constexpr uint32_t ticks = 5000;
+  static UART_DEVICE pairs[4];
+  static uint8_t storage[8][buf_capacity_large];
+  for (uint32_t i = 0; i < 4; i++) {
+    pairs[i] = UART_DEVICE{.state = DeviceState::IDLE, .config = config};
+    attach_buffers(pairs[i], storage[i * 2], storage[i * 2 + 1]);
+    pairs[i].calculate_timing();
+  }
+  serial_connection(pairs[0], pairs[1]);
+  serial_connection(pairs[2], pairs[3]);
+  for (char character : std::string("step_n")) {
+    assert(push_tx_byte(pairs[0], (uint8_t)character) && push_tx_byte(pairs[1], (uint8_t)character));
+    assert(push_tx_byte(pairs[2], (uint8_t)character) && push_tx_byte(pairs[3], (uint8_t)character));
+  }
 
-    tick_down(dev);
-    tick_down(other);
-    simulation_time -= discrete_time_step;
+  UART_DEVICE *batched[] = {&pairs[0], &pairs[1]};
+  step_n(batched, 2, ticks);
+  for (uint32_t tick = 0; tick < ticks; tick++) {
+    step_device(pairs[2]);
+    step_device(pairs[3]);
   }
 
-  return test_passed;
+  for (uint32_t i = 0; i < 2; i++) {
+    const UART_DEVICE &left = pairs[i];
+    const UART_DEVICE &right = pairs[i + 2];
+    if (left.tx_frames != right.tx_frames || left.rx_frames != right.rx_frames || left.clock != right.clock ||
+        left.rx_fifo.count() != right.rx_fifo.count() || left.rx_frames != 6) {
+      return false;
+    }
+  }
+  return true;
 }
 
 bool mismatched_baud_rate_test(UART_DEVICE &dev, UART_DEVICE &other) {
-  uint64_t simulation_time = 10000;  // Much longer simulation time
-  constexpr int msg_length = 300;  // Allow for full message length
-  uint32_t successful_receptions = 0;
-  uint32_t total_attempts = 0;
-  uint32_t state_resets = 0;
-  uint32_t buffer_overflows = 0;
-  uint32_t total_bits_sent = 0;
-  uint32_t total_bits_lost = 0;
+  uint64_t simulation_time = 10000;
   uint32_t idle_time_ticks = 0;
   std::string received_chars;
 
   // Create a much longer message to stress test the timing
   std::string send_string("This is a very long test message to demonstrate baud rate mismatch issues. The transmitter is sending at 115200 baud while the receiver expects 1200 baud, causing significant timing problems and buffer overflow issues.");
   std::unique_ptr<uint8_t[]> bit_arr = string_to_bits(send_string);
-  
+
   // Load data incrementally - only load a few characters at a time
   uint32_t chars_loaded = 0;
   constexpr uint32_t chars_per_load = 5;  // Load 5 characters at a time
 
-  while (simulation_time > 0 && total_attempts < msg_length) {
+  while (simulation_time > 0) {
     // Load more data incrementally when transmitter buffer is getting low
     if (dev.tx_buf.is_empty() && chars_loaded < send_string.length()) {
       uint32_t chars_to_load = std::min(chars_per_load, (uint32_t)(send_string.length() - chars_loaded));
       load_bit_array_tx(dev, &bit_arr[chars_loaded * 8], chars_to_load * 8);
       chars_loaded += chars_to_load;
     }
-    
-    if (is_ready(dev)) {
-      reset_clock(dev);
-      transition_uart_state(dev);
-      buffer_overflows += handle_transmit_with_overflow_detection(dev, total_bits_lost);
-      total_bits_sent += dev.bits_per_frame;  // Count bits attempted to send
-    }
-    
-    if (is_ready(other)) {
-      reset_clock(other);
-      transition_uart_state(other);
-      handle_transmit(other);
-      
-      uint8_t received_char = 0;
-      DeviceState prev_state = other.state;
-      
-      handle_receive(other, received_char);
-      
-      // Count attempts and successful receptions
-      if (prev_state == DeviceState::RECEIVING || prev_state == DeviceState::RECEIVING_AND_TRANSMITTING) {
-        total_attempts++;
-        
-        // Store received character for display
-        if (received_char != 0) {
-          received_chars += static_cast<char>(received_char);
-          successful_receptions++;
-        } else {
-          received_chars += '?';  // Mark failed receptions
-        }
-        
-        // Check if state was reset to IDLE (indicating frame error)
-        if (other.state == DeviceState::IDLE && prev_state != DeviceState::IDLE) {
-          state_resets++;
-        }
-      }
-      
-      // Check for actual buffer overflow by monitoring failed sends
-      // This would happen when the receiver's buffer is full and can't accept more data
+
+    step_device(dev);
+    step_device(other);
+    uint8_t character = 0;
+    while (read_rx_fifo(other, &character, 1) == 1) {
+      received_chars += static_cast<char>(character);
     }
 
     // Track idle time
-    if (dev.state == DeviceState::IDLE && other.state == DeviceState::IDLE) {
+    if (dev.tx_buf.is_empty() && other.rx_buf.is_empty()) {
       idle_time_ticks++;
     }
-
-    tick_down(dev);
-    tick_down(other);
     simulation_time -= discrete_time_step;
   }
 
@@ -263,10 +133,9 @@ bool mismatched_baud_rate_test(UART_DEVICE &dev, UART_DEVICE &other) {
   std::cout << "  Received: \"" << received_chars.substr(0, 60) << (received_chars.length() > 50 ? "..." : "") << "\"" << std::endl;
   std::cout << "  Characters received: " << received_chars.length() << std::endl;
   std::cout << "  Message completion rate: " << (send_string.length() > 0 ? (double)received_chars.length() / (double)send_string.length() * 100.0 : 0.0) << "%" << std::endl;
-  std::cout << "  State resets: " << state_resets << std::endl;
-  std::cout << "  Buffer overflow events: " << buffer_overflows << std::endl;
-  std::cout << "  Total bits sent: " << total_bits_sent << std::endl;
-  std::cout << "  Total bits lost: " << total_bits_lost << std::endl;
+  std::cout << "  Frame errors: " << other.frame_errors << std::endl;
+  std::cout << "  Frames sent: " << dev.tx_frames << std::endl;
+  std::cout << "  Total bits lost: " << dev.dropped_bits << std::endl;
   std::cout << "  Idle time ticks: " << idle_time_ticks << std::endl;
 
   // Test passes if message completion rate is less than 100%
@@ -278,6 +147,61 @@ bool mismatched_baud_rate_test(UART_DEVICE &dev, UART_DEVICE &other) {
   return message_completion_rate < 1.0;
 }
 
+struct event_log {
+  std::string received;
+  uint32_t rx_ready = 0;
+  uint32_t threshold_batches = 0;
+  uint32_t tx_empty = 0;
+  uint32_t errors = 0;
+};
+
+static void on_uart_event(UART_DEVICE &dev, UartEvent event, void *ctx) {
+  event_log &log = *static_cast<event_log *>(ctx);
+  switch (event) {
+    case UartEvent::RX_READY:
+      log.rx_ready++;
+      break;
+    case UartEvent::RX_THRESHOLD: {
+      // Drain the whole batch at once
+      uint8_t batch[rx_fifo_capacity];
+      uint32_t batch_size = read_rx_fifo(dev, batch, rx_fifo_capacity);
+      log.received.append(reinterpret_cast<char *>(batch), batch_size);
+      log.threshold_batches++;
+      break;
+    }
+    case UartEvent::TX_EMPTY:
+      log.tx_empty++;
+      break;
+    default:
+      log.errors++;
+      break;
+  }
+}
+
+bool event_driven_transmission(UART_DEVICE &dev, UART_DEVICE &other) {
+  int simulation_time = 100000;
+  std::string send_string("Interrupts!!");
+  std::unique_ptr<uint8_t[]> bit_arr = string_to_bits(send_string);
+  load_bit_array_tx(dev, bit_arr.get(), send_string.size() * 8);
+
+  event_log tx_log;
+  event_log rx_log;
+  set_event_handler(dev, (uint8_t)UartEvent::TX_EMPTY, on_uart_event, &tx_log);
+  set_event_handler(other, uart_events_all, on_uart_event, &rx_log);
+  set_rx_threshold(other, 4);
+
+  // No polling of the receiver, everything arrives through the handler
+  while (simulation_time > 0 && rx_log.received.size() < send_string.size()) {
+    step_device(dev);
+    step_device(other);
+    simulation_time -= discrete_time_step;
+  }
+
+  return rx_log.received == send_string && rx_log.rx_ready == send_string.size() &&
+         rx_log.threshold_batches == send_string.size() / 4 && rx_log.errors == 0 &&
+         tx_log.tx_empty == 1;
+}
+
 int main() {
 
   constexpr UART_CONFIG default_config = {.baud_rate = 9600,
@@ -288,6 +212,13 @@ int main() {
   UART_DEVICE uart_one = {.state = DeviceState::IDLE, .config = default_config};
   UART_DEVICE uart_two = {.state = DeviceState::IDLE, .config = default_config};
 
+  static uint8_t uart_one_tx[buf_capacity_large];
+  static uint8_t uart_one_rx[buf_capacity_large];
+  static uint8_t uart_two_tx[buf_capacity_large];
+  static uint8_t uart_two_rx[buf_capacity_large];
+  attach_buffers(uart_one, uart_one_tx, uart_one_rx);
+  attach_buffers(uart_two, uart_two_tx, uart_two_rx);
+
   // Calculate timing after config is set
   uart_one.calculate_timing();
   uart_two.calculate_timing();
@@ -300,6 +231,32 @@ int main() {
     std::cout << "Err: Multi-Byte Transmissions" << std::endl;
   }
 
+  if (batched_step_matches_single_step()) {
+    std::cout << "Good: Batched Step Matches Single Step" << std::endl;
+  } else {
+    std::cout << "Err: Batched Step Matches Single Step" << std::endl;
+  }
+
+  UART_DEVICE event_tx = {.state = DeviceState::IDLE, .config = default_config};
+  UART_DEVICE event_rx = {.state = DeviceState::IDLE, .config = default_config};
+
+  // Each device picks its own sizes: a bulk sender and a small idle endpoint
+  static uint8_t event_tx_tx[4096];
+  static uint8_t event_tx_rx[8];
+  static uint8_t event_rx_tx[8];
+  static uint8_t event_rx_rx[buf_capacity_small];
+  attach_buffers(event_tx, event_tx_tx, event_tx_rx);
+  attach_buffers(event_rx, event_rx_tx, event_rx_rx);
+  event_tx.calculate_timing();
+  event_rx.calculate_timing();
+  serial_connection(event_tx, event_rx);
+
+  if (event_driven_transmission(event_tx, event_rx)) {
+    std::cout << "Good: Event Driven Transmission" << std::endl;
+  } else {
+    std::cout << "Err: Event Driven Transmission" << std::endl;
+  }
+
   // Test mismatched baud rates with more extreme differences
   constexpr UART_CONFIG fast_config = {.baud_rate = 56000,
     .data_bits = 8,
@@ -314,6 +271,13 @@ int main() {
   UART_DEVICE fast_uart = {.state = DeviceState::IDLE, .config = fast_config};
   UART_DEVICE slow_uart = {.state = DeviceState::IDLE, .config = slow_config};
 
+  static uint8_t fast_uart_tx[buf_capacity_large];
+  static uint8_t fast_uart_rx[buf_capacity_large];
+  static uint8_t slow_uart_tx[buf_capacity_large];
+  static uint8_t slow_uart_rx[buf_capacity_large];
+  attach_buffers(fast_uart, fast_uart_tx, fast_uart_rx);
+  attach_buffers(slow_uart, slow_uart_tx, slow_uart_rx);
+
   fast_uart.calculate_timing();
   slow_uart.calculate_timing();
 
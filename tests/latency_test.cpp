@@ -0,0 +1,216 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../src/device.hpp"
+#include "../src/latency.hpp"
+#include "../src/snapshot.hpp"
+
+constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+  .data_bits = 8,
+  .stop_bits = 1,
+  .start_bits = 1, };
+
+constexpr uint64_t ns_per_tick = 100000;
+
+struct TRACKED_PAIR {
+  UART_DEVICE uart_one;
+  UART_DEVICE uart_two;
+  UART_LATENCY one_latency;
+  UART_LATENCY two_latency;
+  uint8_t storage[4][buf_capacity_large];
+
+  void init() {
+    uart_one = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    uart_two = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    attach_buffers(uart_one, storage[0], storage[1]);
+    attach_buffers(uart_two, storage[2], storage[3]);
+    uart_one.calculate_timing();
+    uart_two.calculate_timing();
+    enable_latency(uart_one, one_latency);
+    enable_latency(uart_two, two_latency);
+    serial_connection(uart_one, uart_two);
+  }
+};
+
+static uint32_t run_until(TRACKED_PAIR &pair, uint32_t received_target, std::string &received) {
+  UART_DEVICE *devices[] = {&pair.uart_one, &pair.uart_two};
+  uint32_t ticks = 0;
+  while (received.size() < received_target && ticks < 100000) {
+    step_n(devices, 2, 1);
+    uint8_t character = 0;
+    while (read_rx_fifo(pair.uart_two, &character, 1) == 1) {
+      received += static_cast<char>(character);
+    }
+    ticks++;
+  }
+  return ticks;
+}
+
+// Small values are exact, larger ones within one sub bucket, never below
+bool test_latency_histogram() {
+  static LATENCY_HISTOGRAM hist;
+  latency_reset(hist);
+  assert(latency_percentile(hist, 0.5) == 0);
+  for (uint64_t value = 1; value <= 100; value++) {
+    latency_record(hist, value);
+  }
+  assert(latency_percentile(hist, 0.5) == 50 && latency_percentile(hist, 0.99) == 99);
+  assert(latency_percentile(hist, 0.0) == 1 && latency_percentile(hist, 1.0) == 100);
+
+  latency_reset(hist);
+  constexpr uint64_t samples = 1000000;
+  for (uint64_t value = 1; value <= samples; value++) {
+    latency_record(hist, value * 1000);
+  }
+  LATENCY_SUMMARY summary = latency_summary(hist);
+  assert(summary.count == samples && summary.min == 1000 && summary.max == samples * 1000);
+  const double tolerance = 1.0 / latency_sub_buckets;
+  const uint64_t expected[] = {summary.p50, summary.p99, summary.p999};
+  const double exact[] = {0.50 * samples * 1000, 0.99 * samples * 1000, 0.999 * samples * 1000};
+  for (uint32_t i = 0; i < 3; i++) {
+    assert((double)expected[i] >= exact[i] && (double)expected[i] <= exact[i] * (1.0 + tolerance));
+  }
+  assert(summary.mean == (samples + 1) * 500.0);
+
+  // p99 of 1060 samples is rank 1049.4, rounding down would report a value
+  // only 98.96% of samples are at or below
+  latency_reset(hist);
+  for (uint32_t i = 0; i < 1060; i++) {
+    latency_record(hist, i < 1049 ? 10 : 20);
+  }
+  assert(latency_percentile(hist, 0.99) == 20 && latency_percentile(hist, 0.98) == 10);
+
+  // Out of range values are clamped into the top bucket but still the max
+  latency_reset(hist);
+  latency_record(hist, 5);
+  latency_record(hist, (uint64_t)1 << 50);
+  return hist.clamped == 1 && latency_percentile(hist, 0.5) == 5 && latency_percentile(hist, 1.0) == (uint64_t)1 << 50;
+}
+
+// A burst queues behind itself, byte n waits for the n frames ahead of it.
+// The receiver's tick count starts elsewhere, tags are rebased on the way.
+bool test_latency_under_load() {
+  static TRACKED_PAIR pair;
+  pair.init();
+  pair.uart_two.ticks = 0xFFFFFF00;
+  std::string message("Tail latency is what SLAs are in");
+  for (char character : message) {
+    assert(push_tx_byte(pair.uart_one, (uint8_t)character));
+  }
+  std::string received;
+  run_until(pair, message.size(), received);
+  assert(received == message);
+
+  const LATENCY_SUMMARY summary = latency_summary(pair.two_latency.histogram);
+  const uint64_t per_frame = summary.min;
+  assert(per_frame % ns_per_tick == 0 && per_frame >= pair.uart_one.time_per_byte * 1e9);
+  assert(summary.count == message.size() && summary.max == per_frame * message.size());
+  assert(summary.p50 >= per_frame * message.size() / 2 && summary.p99 == summary.max);
+  assert(pair.one_latency.histogram.total == 0 && pair.one_latency.tx_tags.is_empty());
+
+  // Unloaded, a byte only waits for its own frame
+  latency_reset(pair.two_latency.histogram);
+  for (uint32_t i = 0; i < 8; i++) {
+    assert(push_tx_byte(pair.uart_one, (uint8_t)('a' + i)));
+    run_until(pair, received.size() + 1, received);
+  }
+  return pair.two_latency.histogram.total == 8 && pair.two_latency.histogram.max <= 2 * per_frame &&
+         pair.one_latency.lost_tags == 0 && pair.two_latency.lost_tags == 0;
+}
+
+// A frame error flushes the line and its tags, later bytes still line up
+bool test_latency_resync() {
+  static TRACKED_PAIR pair;
+  pair.init();
+  // Raw line bits tag a character once its last bit is queued
+  const uint8_t bits[] = {0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 1, 0};
+  assert(load_bit_array_tx(pair.uart_one, bits, 12) == 12);
+  assert(pair.one_latency.tx_tags.count() == 1 && pair.one_latency.tx_bits == 4);
+  assert(load_bit_array_tx(pair.uart_one, bits + 12, 4) == 4 && pair.one_latency.tx_tags.count() == 2);
+  assert(push_tx_byte(pair.uart_one, 'C') && push_tx_byte(pair.uart_one, 'D'));
+
+  std::string received;
+  run_until(pair, 1, received);
+  const uint64_t per_frame = pair.two_latency.histogram.max;
+  // A lone high bit ahead of the next frame is a bad start bit
+  pair.uart_one.tx_serial_connection->push(1);
+  run_until(pair, 2, received);
+
+  // B went down with the bad bit, C still gets its own enqueue time
+  assert(received == "AC" && pair.uart_two.frame_errors == 1);
+  const LATENCY_HISTOGRAM &hist = pair.two_latency.histogram;
+  return hist.total == 2 && pair.two_latency.lost_tags == 1 && hist.max == 3 * per_frame &&
+         pair.two_latency.line_tags.is_empty();
+}
+
+// A rewind drops the tags in flight, the restored characters replay without
+// samples and bytes queued afterwards are timed from the restored ticks
+bool test_latency_snapshot_restore() {
+  static TRACKED_PAIR pair;
+  pair.init();
+  UART_DEVICE *devices[] = {&pair.uart_one, &pair.uart_two};
+  for (char character : std::string("rewind")) {
+    assert(push_tx_byte(pair.uart_one, (uint8_t)character));
+  }
+  std::string received;
+  run_until(pair, 2, received);
+  std::vector<uint8_t> image(snapshot_size(devices, 2, 0));
+  assert(snapshot_save(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()) != 0);
+  const uint32_t saved_ticks[] = {pair.uart_one.ticks, pair.uart_two.ticks};
+  const uint64_t per_frame = pair.two_latency.histogram.min;
+
+  // Fresh bytes are in flight when the rewind puts the old ones back
+  run_until(pair, 6, received);
+  for (char character : std::string("later")) {
+    assert(push_tx_byte(pair.uart_one, (uint8_t)character));
+  }
+  run_until(pair, 8, received);
+  assert(received == "rewindla" && !pair.one_latency.tx_tags.is_empty());
+  assert(snapshot_restore(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()));
+  assert(pair.uart_one.ticks == saved_ticks[0] && pair.uart_two.ticks == saved_ticks[1]);
+  assert(pair.one_latency.tx_tags.is_empty() && pair.two_latency.line_tags.is_empty());
+
+  const uint64_t recorded = pair.two_latency.histogram.total;
+  std::string replayed;
+  run_until(pair, 4, replayed);
+  assert(replayed == "wind" && pair.two_latency.histogram.total == recorded);
+
+  latency_reset(pair.two_latency.histogram);
+  assert(push_tx_byte(pair.uart_one, 'x'));
+  run_until(pair, 5, replayed);
+  const LATENCY_HISTOGRAM &hist = pair.two_latency.histogram;
+  return replayed == "windx" && hist.total == 1 && hist.max <= 2 * per_frame &&
+         pair.one_latency.lost_tags == 0 && pair.two_latency.lost_tags == 0;
+}
+
+int main() {
+  if (test_latency_histogram()) {
+    std::cout << "Good: Latency Histogram Percentiles" << std::endl;
+  } else {
+    std::cout << "Err: Latency Histogram Percentiles" << std::endl;
+  }
+
+  if (test_latency_under_load()) {
+    std::cout << "Good: Latency Under Load" << std::endl;
+  } else {
+    std::cout << "Err: Latency Under Load" << std::endl;
+  }
+
+  if (test_latency_resync()) {
+    std::cout << "Good: Latency Tags Resync After Frame Error" << std::endl;
+  } else {
+    std::cout << "Err: Latency Tags Resync After Frame Error" << std::endl;
+  }
+
+  if (test_latency_snapshot_restore()) {
+    std::cout << "Good: Latency Tags Across Snapshot Restore" << std::endl;
+  } else {
+    std::cout << "Err: Latency Tags Across Snapshot Restore" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
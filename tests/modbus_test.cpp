@@ -0,0 +1,182 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/modbus.hpp"
+
+constexpr UART_CONFIG rtu_config = {.baud_rate = 9600,
+  .data_bits = 8,
+  .stop_bits = 2,
+  .start_bits = 1, };
+
+// Reference ADUs from the Modbus over serial line guide
+bool test_modbus_adu() {
+  uint8_t adu[modbus_max_adu];
+  const uint8_t read_expected[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD};
+  assert(modbus_read_request(adu, 1, 0x0000, 10) == sizeof(read_expected));
+  for (uint32_t i = 0; i < sizeof(read_expected); i++) {
+    assert(adu[i] == read_expected[i]);
+  }
+  assert(modbus_check_crc(adu, 8));
+  adu[3] ^= 0x01;
+  assert(!modbus_check_crc(adu, 8));
+
+  const uint8_t write_expected[] = {0x01, 0x06, 0x00, 0x01, 0x00, 0x03, 0x98, 0x0B};
+  assert(modbus_write_request(adu, 1, 0x0001, 0x0003) == sizeof(write_expected));
+  for (uint32_t i = 0; i < sizeof(write_expected); i++) {
+    assert(adu[i] == write_expected[i]);
+  }
+  return !modbus_check_crc(adu, 3);
+}
+
+// Frames end after 3.5 quiet characters, a 1.5 character gap spoils one
+bool test_modbus_rx_timing() {
+  UART_DEVICE dev = {.state = DeviceState::IDLE, .config = rtu_config};
+  dev.calculate_timing();
+  MODBUS_TIMING timing = modbus_timing(dev);
+  assert(timing.t1_5 == 1.5 * dev.time_per_byte && timing.t3_5 == 3.5 * dev.time_per_byte);
+
+  uint8_t adu[modbus_max_adu];
+  uint32_t length = modbus_read_request(adu, 7, 0x0010, 2);
+  MODBUS_RX rx;
+  double now = 0.0;
+  for (uint32_t i = 0; i < length; i++) {
+    modbus_rx_byte(rx, adu[i], now, timing);
+    now += dev.time_per_byte;
+  }
+  double last = now - dev.time_per_byte;
+  assert(!modbus_rx_frame(rx, last + 3.4 * dev.time_per_byte, timing));
+  assert(modbus_rx_frame(rx, last + 3.51 * dev.time_per_byte, timing));
+  assert(rx.length == length && rx.adu[0] == 7 && rx.frames == 1);
+  assert(!modbus_rx_frame(rx, last + 10 * dev.time_per_byte, timing));
+
+  // A 1 character silence after the third byte is still one frame, 1.6 is
+  // past the 1.5 character limit
+  const double silences[] = {1.0, 1.6};
+  for (double silence : silences) {
+    now = 0.0;
+    for (uint32_t i = 0; i < length; i++) {
+      now += dev.time_per_byte;
+      modbus_rx_byte(rx, adu[i], now, timing);
+      if (i == 2) {
+        now += silence * dev.time_per_byte;
+      }
+    }
+    assert(modbus_rx_frame(rx, now + 4 * dev.time_per_byte, timing) == (silence < 1.5));
+  }
+  assert(rx.broken_frames == 1 && rx.frames == 2);
+
+  // Fast links use the fixed spec timers
+  dev.config.baud_rate = 115200;
+  dev.calculate_timing();
+  timing = modbus_timing(dev);
+  return timing.t1_5 == 0.000750 && timing.t3_5 == 0.001750;
+}
+
+bool test_modbus_slave_respond() {
+  uint16_t registers[modbus_registers];
+  for (uint32_t i = 0; i < modbus_registers; i++) {
+    registers[i] = (uint16_t)(0x1000 + i);
+  }
+  uint8_t request[modbus_max_adu];
+  uint8_t response[modbus_max_adu];
+
+  uint32_t length = modbus_read_request(request, 3, 4, 2);
+  assert(modbus_slave_respond(registers, 2, request, length, response) == 0);
+  assert(modbus_slave_respond(registers, 3, request, length, response) == 9);
+  assert(modbus_check_crc(response, 9) && response[1] == modbus_read_holding && response[2] == 4);
+  assert(response[3] == 0x10 && response[4] == 0x04 && response[5] == 0x10 && response[6] == 0x05);
+
+  length = modbus_write_request(request, 3, 5, 0xBEEF);
+  assert(modbus_slave_respond(registers, 3, request, length, response) == length);
+  assert(registers[5] == 0xBEEF && response[4] == 0xBE && response[5] == 0xEF);
+
+  length = modbus_read_request(request, 3, modbus_registers - 1, 2);
+  assert(modbus_slave_respond(registers, 3, request, length, response) == 5);
+  return modbus_check_crc(response, 5) && response[1] == (modbus_read_holding | modbus_exception_flag) &&
+         response[2] == modbus_illegal_address;
+}
+
+static void record_latency(double latency, void *ctx) { static_cast<std::vector<double> *>(ctx)->push_back(latency); }
+
+// Master and slaves on one bus, every request answered inside the timeout
+// and no faster than the characters on the line allow
+bool test_modbus_workload() {
+  constexpr uint32_t slave_count = 3;
+  constexpr uint32_t transactions = 200;
+  static UART_DEVICE devices[slave_count + 1];
+  static uint8_t storage[(slave_count + 1) * 2][buf_capacity_large];
+  UART_DEVICE *slaves[slave_count];
+  for (uint32_t i = 0; i <= slave_count; i++) {
+    devices[i] = UART_DEVICE{.state = DeviceState::IDLE, .config = rtu_config};
+    devices[i].calculate_timing();
+    attach_buffers(devices[i], storage[i * 2], storage[i * 2 + 1]);
+    if (i > 0) {
+      slaves[i - 1] = &devices[i];
+    }
+  }
+
+  static UART_BUS bus;
+  static MODBUS_WORKLOAD workload;
+  MODBUS_WORKLOAD_CONFIG config;
+  config.slave_count = slave_count;
+  config.write_percent = 50;
+  config.bad_address_percent = 10;
+  assert(modbus_workload_init(workload, bus, devices[0], slaves, config));
+  std::vector<double> latencies;
+  workload.latency_handler = record_latency;
+  workload.latency_ctx = &latencies;
+
+  while (workload.stats.transactions < transactions && workload.ticks < 10000000) {
+    modbus_workload_step(workload);
+  }
+  const MODBUS_STATS &stats = workload.stats;
+  assert(stats.transactions == transactions && latencies.size() == transactions);
+  assert(stats.timeouts == 0 && stats.bad_responses == 0 && stats.crc_errors == 0 && stats.broken_frames == 0);
+  assert(stats.exceptions > 0 && stats.exceptions < transactions / 4);
+  assert(bus.collisions == 0);
+
+  // Shortest exchange is an 8 byte request and a 5 byte exception, each
+  // closed by 3.5 characters of silence
+  double floor = (8 + 5 + 3.5) * devices[0].time_per_byte;
+  for (double latency : latencies) {
+    assert(latency >= floor && latency <= stats.latency_max);
+  }
+  uint32_t written = 0;
+  for (uint32_t i = 0; i < slave_count; i++) {
+    for (uint32_t reg = 0; reg < modbus_registers; reg++) {
+      written += workload.registers[i][reg] != (uint16_t)((i + 1) * 0x100 + reg);
+    }
+  }
+  return written > 0;
+}
+
+int main() {
+  if (test_modbus_adu()) {
+    std::cout << "Good: Modbus ADU and CRC" << std::endl;
+  } else {
+    std::cout << "Err: Modbus ADU and CRC" << std::endl;
+  }
+
+  if (test_modbus_rx_timing()) {
+    std::cout << "Good: Modbus RTU Frame Timing" << std::endl;
+  } else {
+    std::cout << "Err: Modbus RTU Frame Timing" << std::endl;
+  }
+
+  if (test_modbus_slave_respond()) {
+    std::cout << "Good: Modbus Slave Responses" << std::endl;
+  } else {
+    std::cout << "Err: Modbus Slave Responses" << std::endl;
+  }
+
+  if (test_modbus_workload()) {
+    std::cout << "Good: Modbus Workload" << std::endl;
+  } else {
+    std::cout << "Err: Modbus Workload" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
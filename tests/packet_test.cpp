@@ -0,0 +1,211 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../src/packet.hpp"
+
+constexpr uint32_t discrete_time_step = 1;
+
+static const uint8_t *bytes_of(const char *str) { return reinterpret_cast<const uint8_t *>(str); }
+
+static std::vector<uint8_t> view_bytes(const PACKET_VIEW &view) {
+  std::vector<uint8_t> out;
+  for (uint32_t i = 0; i < view.length(); i++) out.push_back(view.at(i));
+  return out;
+}
+
+bool test_crc_vectors() {
+  assert(crc32(bytes_of("123456789"), 9) == 0xCBF43926u);
+  assert(crc16(bytes_of("123456789"), 9) == 0x4B37);
+  assert(crc32(nullptr, 0) == 0);
+
+  // Chaining over any split matches the one shot value, covers the 8 byte path
+  std::string text("The quick brown fox jumps over the lazy dog");
+  const uint8_t *data = bytes_of(text.c_str());
+  uint32_t length = (uint32_t)text.size();
+  assert(crc32(data, length) == 0x414FA339u);
+  for (uint32_t split = 0; split <= length; split++) {
+    assert(crc32_update(crc32(data, split), data + split, length - split) == crc32(data, length));
+    assert(crc16_update(crc16(data, split), data + split, length - split) == crc16(data, length));
+  }
+  return true;
+}
+
+static bool cobs_matches(const std::vector<uint8_t> &in, const std::vector<uint8_t> &expected) {
+  uint8_t encoded[600];
+  uint8_t decoded[600];
+  uint32_t encoded_length = 0;
+  uint32_t decoded_length = 0;
+  if (!cobs_encode(in.data(), (uint32_t)in.size(), encoded, sizeof(encoded), encoded_length)) return false;
+  if (std::vector<uint8_t>(encoded, encoded + encoded_length) != expected) return false;
+  if (!cobs_decode(encoded, encoded_length, decoded, sizeof(decoded), decoded_length)) return false;
+  return std::vector<uint8_t>(decoded, decoded + decoded_length) == in;
+}
+
+bool test_cobs_vectors() {
+  assert(cobs_matches({0x00}, {0x01, 0x01, 0x00}));
+  assert(cobs_matches({0x00, 0x00}, {0x01, 0x01, 0x01, 0x00}));
+  assert(cobs_matches({0x11, 0x22, 0x00, 0x33}, {0x03, 0x11, 0x22, 0x02, 0x33, 0x00}));
+  assert(cobs_matches({0x11, 0x00, 0x00, 0x00}, {0x02, 0x11, 0x01, 0x01, 0x01, 0x00}));
+
+  // 254 non zero bytes fit one block, the 255th starts a new one
+  std::vector<uint8_t> block;
+  std::vector<uint8_t> expected = {0xFF};
+  for (uint32_t i = 1; i <= 254; i++) {
+    block.push_back((uint8_t)i);
+    expected.push_back((uint8_t)i);
+  }
+  expected.push_back(0x00);
+  assert(cobs_matches(block, expected));
+  block.push_back(0xFF);
+  expected.pop_back();
+  expected.push_back(0x02);
+  expected.push_back(0xFF);
+  expected.push_back(0x00);
+  assert(cobs_matches(block, expected));
+
+  uint8_t out[8];
+  uint32_t out_length = 0;
+  const uint8_t bad[] = {0x05, 0x11, 0x00};
+  assert(!cobs_decode(bad, 3, out, sizeof(out), out_length));
+  return true;
+}
+
+bool test_slip_round_trip() {
+  const uint8_t in[] = {0x01, slip_end, 0x02, slip_esc, 0x03};
+  const uint8_t expected[] = {0x01, slip_esc, slip_esc_end, 0x02, slip_esc, slip_esc_esc, 0x03, slip_end};
+  uint8_t encoded[16];
+  uint8_t decoded[16];
+  uint32_t encoded_length = 0;
+  uint32_t decoded_length = 0;
+  assert(slip_encode(in, sizeof(in), encoded, sizeof(encoded), encoded_length));
+  assert(encoded_length == sizeof(expected));
+  for (uint32_t i = 0; i < encoded_length; i++) assert(encoded[i] == expected[i]);
+  assert(slip_decode(encoded, encoded_length, decoded, sizeof(decoded), decoded_length));
+  assert(decoded_length == sizeof(in));
+  for (uint32_t i = 0; i < decoded_length; i++) assert(decoded[i] == in[i]);
+
+  const uint8_t bad[] = {0x01, slip_esc, 0x02, slip_end};
+  assert(!slip_decode(bad, sizeof(bad), decoded, sizeof(decoded), decoded_length));
+  return true;
+}
+
+// Frames land split over the ring edge, the view hands back both halves
+bool test_reader_wrapped_in_place() {
+  uint8_t storage[32];
+  uint8_t scratch[64];
+  uint32_t encoded = 0;
+  PACKET_READER reader;
+  packet_reader_init(reader, storage, sizeof(storage), PacketFraming::COBS, PacketCheck::CRC32);
+
+  for (uint32_t round = 0; round < 20; round++) {
+    uint8_t payload[12];
+    for (uint32_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)((round * 7 + i) % 3 == 0 ? 0 : round + i);
+    uint8_t framed[16];
+    for (uint32_t i = 0; i < sizeof(payload); i++) framed[i] = payload[i];
+    uint32_t crc = crc32(payload, sizeof(payload));
+    for (uint32_t i = 0; i < 4; i++) framed[sizeof(payload) + i] = (uint8_t)(crc >> (8 * i));
+    assert(cobs_encode(framed, sizeof(framed), scratch, sizeof(scratch), encoded));
+    assert(packet_reader_write(reader, scratch, encoded) == encoded);
+
+    PACKET_VIEW view;
+    assert(packet_reader_next(reader, view));
+    assert(view.first >= storage && view.first < storage + sizeof(storage));
+    assert(view_bytes(view) == std::vector<uint8_t>(payload, payload + sizeof(payload)));
+    assert(!packet_reader_next(reader, view));
+    packet_reader_release(reader, view);
+  }
+  assert(reader.packets == 20 && reader.crc_errors == 0);
+  assert(reader.bytes.is_empty());
+
+  // A frame with no delimiter that fills the ring is dropped
+  uint8_t junk[32];
+  for (uint8_t &value : junk) value = 0x55;
+  assert(packet_reader_write(reader, junk, sizeof(junk)) == sizeof(junk));
+  PACKET_VIEW view;
+  assert(!packet_reader_next(reader, view));
+  assert(reader.oversize_drops == 1 && reader.bytes.is_empty());
+  return true;
+}
+
+bool test_packet_transfer() {
+  constexpr UART_CONFIG config_8n1 = {.baud_rate = 115200, .data_bits = 8, .stop_bits = 1, .start_bits = 1};
+  UART_DEVICE uart_one = {.state = DeviceState::IDLE, .config = config_8n1};
+  UART_DEVICE uart_two = {.state = DeviceState::IDLE, .config = config_8n1};
+  uint8_t one_tx[4096];
+  uint8_t one_rx[buf_capacity_small];
+  uint8_t two_tx[buf_capacity_small];
+  uint8_t two_rx[buf_capacity_large];
+  attach_buffers(uart_one, one_tx, one_rx);
+  attach_buffers(uart_two, two_tx, two_rx);
+  uart_one.calculate_timing();
+  uart_two.calculate_timing();
+  serial_connection(uart_one, uart_two);
+
+  uint8_t scratch[64];
+  uint8_t reader_storage[64];
+  PACKET_READER reader;
+  packet_reader_init(reader, reader_storage, sizeof(reader_storage), PacketFraming::SLIP, PacketCheck::CRC16);
+
+  std::vector<std::string> messages = {"hello", std::string("nul\0inside", 10), "\xC0\xDB escapes", "last one"};
+  for (const std::string &message : messages) {
+    assert(packet_send(uart_one, PacketFraming::SLIP, PacketCheck::CRC16, bytes_of(message.data()),
+                       (uint32_t)message.size(), scratch, sizeof(scratch)));
+  }
+  // Frame with a corrupted check, counted and skipped by the reader
+  uint8_t corrupt[] = {'b', 'a', 'd', 0x00, 0x00};
+  uint32_t encoded = 0;
+  assert(slip_encode(corrupt, sizeof(corrupt), scratch, sizeof(scratch), encoded));
+  for (uint32_t i = 0; i < encoded; i++) push_tx_byte(uart_one, scratch[i]);
+  assert(packet_send(uart_one, PacketFraming::SLIP, PacketCheck::CRC16, bytes_of("after"), 5, scratch,
+                     sizeof(scratch)));
+  messages.push_back("after");
+
+  std::vector<std::string> received;
+  int simulation_time = 200000;
+  while (simulation_time > 0 && received.size() < messages.size()) {
+    service_device(uart_one);
+    service_device(uart_two);
+    packet_reader_fill(reader, uart_two);
+    PACKET_VIEW view;
+    while (packet_reader_next(reader, view)) {
+      std::vector<uint8_t> payload = view_bytes(view);
+      received.emplace_back(payload.begin(), payload.end());
+      packet_reader_release(reader, view);
+    }
+    tick_down(uart_one);
+    tick_down(uart_two);
+    simulation_time -= discrete_time_step;
+  }
+
+  return received == messages && reader.crc_errors == 1 && reader.packets == messages.size();
+}
+
+int main() {
+  if (test_crc_vectors()) {
+    std::cout << "Good: CRC-16/CRC-32 Vectors" << std::endl;
+  }
+
+  if (test_cobs_vectors()) {
+    std::cout << "Good: COBS Vectors" << std::endl;
+  }
+
+  if (test_slip_round_trip()) {
+    std::cout << "Good: SLIP Round Trip" << std::endl;
+  }
+
+  if (test_reader_wrapped_in_place()) {
+    std::cout << "Good: Packet Reader Wrapped In Place" << std::endl;
+  }
+
+  if (test_packet_transfer()) {
+    std::cout << "Good: Packet Transfer" << std::endl;
+  } else {
+    std::cout << "Err: Packet Transfer" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
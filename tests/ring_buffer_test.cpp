@@ -4,6 +4,7 @@
 #include <cstdlib>
 
 #include "../src/ring_buffer.hpp"
+#include "../src/ext_ring_buffer.hpp"
 
 bool test_ring_buffer_operations() {
     ring_buffer<uint8_t, 4> buf;
@@ -109,6 +110,75 @@ bool test_ring_buffer_edge_cases() {
     return true;
 }
 
+bool test_ext_ring_buffer_runtime_capacity() {
+    uint8_t storage[8];
+    ext_ring_buffer<uint8_t> buf(storage, 6); // Rounded down to 4
+
+    assert(buf.capacity() == 4);
+    assert(buf.is_empty());
+    assert(buf.push(1));
+    assert(buf.push(2));
+    assert(buf.push(3));
+    assert(buf.push(4));
+    assert(buf.is_full());
+    assert(!buf.push(5));
+
+    uint8_t value;
+    (void)value;
+    assert(buf.pop(value) && value == 1);
+    assert(buf.push(5));
+    assert(buf.count() == 4);
+    assert(buf.pop(value) && value == 2);
+    assert(buf.pop(value) && value == 3);
+    assert(buf.pop(value) && value == 4);
+    assert(buf.pop(value) && value == 5);
+    assert(!buf.pop(value));
+
+    // No storage means nothing fits
+    ext_ring_buffer<uint8_t> detached;
+    assert(detached.capacity() == 0);
+    assert(!detached.push(1));
+    assert(detached.is_empty());
+
+    return true;
+}
+
+bool test_ext_ring_buffer_copy_and_move() {
+    int storage_a[16];
+    int storage_b[4];
+    ext_ring_buffer<int> a(storage_a, 16);
+    for (int i = 0; i < 12; ++i) {
+        a.push(i);
+    }
+    int value;
+    (void)value;
+    for (int i = 0; i < 10; ++i) {
+        a.pop(value);
+    }
+
+    // Copy walks only the two live slots into our own storage
+    for (int &slot : storage_b) slot = -1;
+    ext_ring_buffer<int> b(storage_b, 4);
+    b = a;
+    assert(b.storage() == storage_b);
+    assert(b.count() == 2);
+    assert(storage_b[2] == -1 && storage_b[3] == -1);
+    assert(b.pop(value) && value == 10);
+    assert(b.pop(value) && value == 11);
+
+    // Move hands over the storage pointer
+    ext_ring_buffer<int> c(static_cast<ext_ring_buffer<int>&&>(a));
+    assert(c.storage() == storage_a);
+    assert(a.storage() == nullptr && a.capacity() == 0);
+    assert(c.count() == 2);
+
+    b = static_cast<ext_ring_buffer<int>&&>(c);
+    assert(b.storage() == storage_a && c.storage() == storage_b);
+    assert(b.pop(value) && value == 10);
+
+    return true;
+}
+
 int main() {
     if (test_ring_buffer_operations()) {
         std::cout << "Good: Ring Buffer Operations" << std::endl;
@@ -126,5 +196,13 @@ int main() {
         std::cout << "Good: Ring Buffer Edge Cases" << std::endl;
     }
 
+    if (test_ext_ring_buffer_runtime_capacity()) {
+        std::cout << "Good: External Ring Buffer Runtime Capacity" << std::endl;
+    }
+
+    if (test_ext_ring_buffer_copy_and_move()) {
+        std::cout << "Good: External Ring Buffer Copy And Move" << std::endl;
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/shm_link.hpp"
+
+constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+  .data_bits = 8,
+  .stop_bits = 1,
+  .start_bits = 1, };
+constexpr uint64_t wait_ns = 1000000;
+constexpr int max_rounds = 100000;
+
+// time_per_byte stays 0, so every service_device() call moves a frame.
+// shm_link_attach() replaces the rx_buf storage, only tx_buf needs its own.
+static void make_device(UART_DEVICE &dev, uint8_t (&tx_storage)[buf_capacity_large]) {
+  dev = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+  attach_buffers(dev, tx_storage, buf_capacity_large, nullptr, 0);
+}
+
+static void service_link(SHM_LINK &link, UART_DEVICE &dev, std::string &received) {
+  shm_link_sync(link, dev);
+  service_device(dev);
+  shm_link_sync(link, dev);
+  uint8_t value = 0;
+  while (dev.rx_fifo.pop(value)) {
+    received += (char)value;
+  }
+}
+
+// Echoes count bytes back to the parent, exit status 0 on success
+static int echo_child(int fd, size_t count) {
+  SHM_LINK link;
+  if (!shm_link_open_fd(link, fd)) {
+    return 1;
+  }
+  static UART_DEVICE dev;
+  static uint8_t tx_storage[buf_capacity_large];
+  make_device(dev, tx_storage);
+  shm_link_attach(link, dev);
+
+  std::string received;
+  size_t echoed = 0;
+  for (int round = 0; round < max_rounds && (echoed < count || !dev.tx_buf.is_empty()); round++) {
+    if (dev.tx_buf.is_empty()) {
+      shm_link_wait(link, wait_ns);
+    }
+    service_link(link, dev, received);
+    while (echoed < received.size() && push_tx_byte(dev, (uint8_t)received[echoed])) {
+      echoed++;
+    }
+  }
+  shm_link_close(link);
+  return echoed == count && dev.tx_buf.is_empty() ? 0 : 2;
+}
+
+// A forked peer in its own address space echoes through an anonymous memfd
+bool test_shm_link_two_processes() {
+  SHM_LINK link;
+  assert(shm_link_create(link, nullptr, 1024));
+  const std::string message = "Hello across processes, one ring per direction!";
+
+  pid_t child = fork();
+  assert(child >= 0);
+  if (child == 0) {
+    _exit(echo_child(link.fd, message.size()));
+  }
+
+  UART_DEVICE dev;
+  static uint8_t tx_storage[buf_capacity_large];
+  make_device(dev, tx_storage);
+  shm_link_attach(link, dev);
+
+  std::string received;
+  size_t sent = 0;
+  for (int round = 0; round < max_rounds && received.size() < message.size(); round++) {
+    while (sent < message.size() && push_tx_byte(dev, (uint8_t)message[sent])) {
+      sent++;
+    }
+    if (dev.tx_buf.is_empty()) {
+      shm_link_wait(link, wait_ns);
+    }
+    service_link(link, dev, received);
+  }
+
+  int status = 0;
+  assert(waitpid(child, &status, 0) == child);
+  shm_link_close(link);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  assert(dev.frame_errors == 0 && dev.dropped_bits == 0);
+  return received == message;
+}
+
+// Both ends of a named region mapped twice in one process. Bits only cross
+// at sync, a bad frame flushes what was shown, and the name goes with the
+// creator.
+bool test_shm_link_named() {
+  const std::string name = "/uart_shm_link_test_" + std::to_string(getpid());
+  SHM_LINK a;
+  SHM_LINK b;
+  SHM_LINK taken;
+  assert(shm_link_create(a, name.c_str(), 256));
+  assert(!shm_link_create(taken, name.c_str(), 256));
+  assert(shm_link_open(b, name.c_str()));
+  assert(a.region != b.region);
+
+  static UART_DEVICE dev_a;
+  static UART_DEVICE dev_b;
+  static uint8_t storage[2][buf_capacity_large];
+  make_device(dev_a, storage[0]);
+  make_device(dev_b, storage[1]);
+  shm_link_attach(a, dev_a);
+  shm_link_attach(b, dev_b);
+  // Receivers decode straight out of the mapping
+  assert(dev_a.rx_buf.capacity() == 256 && dev_a.rx_buf.storage() >= a.region &&
+         dev_a.rx_buf.storage() < a.region + a.region_size);
+
+  // Sent but not yet synced, the peer sees nothing
+  assert(!shm_link_wait(b, 0));
+  assert(push_tx_byte(dev_a, 'A'));
+  service_device(dev_a);
+  assert(!shm_link_wait(b, 0));
+  shm_link_sync(a, dev_a);
+  assert(shm_link_wait(b, wait_ns));
+  std::string received;
+  std::string back;
+  service_link(b, dev_b, received);
+  assert(received == "A" && !shm_link_wait(b, 0));
+
+  // Garbage ahead of a frame is flushed along with it, the next frame is clean
+  a.outbound.push(1);
+  a.outbound.push(1);
+  shm_link_sync(a, dev_a);
+  service_link(b, dev_b, received);
+  assert(dev_b.frame_errors == 1 && !shm_link_wait(b, 0));
+  assert(push_tx_byte(dev_a, 'B'));
+  service_link(a, dev_a, back);
+  service_link(b, dev_b, received);
+  assert(received == "AB");
+
+  // The other direction
+  assert(push_tx_byte(dev_b, 'z'));
+  service_link(b, dev_b, received);
+  assert(shm_link_wait(a, wait_ns));
+  service_link(a, dev_a, back);
+  assert(back == "z");
+
+  shm_link_close(b);
+  shm_link_close(a);
+  SHM_LINK gone;
+  return !shm_link_open(gone, name.c_str());
+}
+
+// Nothing published, the wait times out
+bool test_shm_link_wait_timeout() {
+  SHM_LINK link;
+  assert(shm_link_create(link, nullptr, 64));
+  UART_DEVICE dev;
+  static uint8_t tx_storage[buf_capacity_large];
+  make_device(dev, tx_storage);
+  shm_link_attach(link, dev);
+  bool woke = shm_link_wait(link, 2 * wait_ns);
+  shm_link_close(link);
+  return !woke;
+}
+
+int main() {
+  if (test_shm_link_two_processes()) {
+    std::cout << "Good: Shared Memory Link Two Processes" << std::endl;
+  } else {
+    std::cout << "Err: Shared Memory Link Two Processes" << std::endl;
+  }
+
+  if (test_shm_link_named()) {
+    std::cout << "Good: Shared Memory Link Named Region" << std::endl;
+  } else {
+    std::cout << "Err: Shared Memory Link Named Region" << std::endl;
+  }
+
+  if (test_shm_link_wait_timeout()) {
+    std::cout << "Good: Shared Memory Link Wait Timeout" << std::endl;
+  } else {
+    std::cout << "Err: Shared Memory Link Wait Timeout" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "../src/snapshot.hpp"
+
+constexpr uint32_t discrete_time_step = 1;
+
+constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+  .data_bits = 8,
+  .stop_bits = 1,
+  .start_bits = 1, };
+
+struct LINKED_PAIR {
+  UART_DEVICE uart_one = {.state = DeviceState::IDLE, .config = default_config};
+  UART_DEVICE uart_two = {.state = DeviceState::IDLE, .config = default_config};
+  uint8_t one_tx[buf_capacity_large] = {};
+  uint8_t one_rx[buf_capacity_small] = {};
+  uint8_t two_tx[buf_capacity_small] = {};
+  uint8_t two_rx[buf_capacity_large] = {};
+
+  LINKED_PAIR() {
+    attach_buffers(uart_one, one_tx, one_rx);
+    attach_buffers(uart_two, two_tx, two_rx);
+    uart_one.calculate_timing();
+    uart_two.calculate_timing();
+    serial_connection(uart_one, uart_two);
+  }
+};
+
+// Steps the pair and appends what uart_two decodes
+static void run_pair(LINKED_PAIR &pair, std::string &received, int simulation_time) {
+  while (simulation_time > 0) {
+    step_device(pair.uart_one);
+    step_device(pair.uart_two);
+    uint8_t batch[rx_fifo_capacity];
+    uint32_t batch_size = read_rx_fifo(pair.uart_two, batch, rx_fifo_capacity);
+    received.append(reinterpret_cast<char *>(batch), batch_size);
+    simulation_time -= discrete_time_step;
+  }
+}
+
+static void queue_string(UART_DEVICE &dev, const std::string &text) {
+  for (char character : text) {
+    assert(push_tx_byte(dev, (uint8_t)character));
+  }
+}
+
+bool test_snapshot_rewind() {
+  static LINKED_PAIR pair;
+  UART_DEVICE *devices[] = {&pair.uart_one, &pair.uart_two};
+  queue_string(pair.uart_one, "Rewind me please");
+
+  std::string before;
+  run_pair(pair, before, 50);
+  // Leave a byte in rx_fifo so it is part of the image too
+  while (pair.uart_two.rx_fifo.is_empty()) {
+    step_n(devices, 2, 1);
+  }
+  assert(pair.uart_two.rx_fifo.count() > 0 && pair.uart_one.tx_buf.count() > 0);
+
+  std::vector<uint8_t> image(snapshot_size(devices, 2, 0));
+  assert(snapshot_save(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()) == image.size());
+  double clock = pair.uart_one.clock;
+
+  std::string first_run;
+  run_pair(pair, first_run, 400);
+  assert(pair.uart_one.tx_buf.is_empty());
+
+  assert(snapshot_restore(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()));
+  assert(pair.uart_one.clock == clock);
+  std::string second_run;
+  run_pair(pair, second_run, 400);
+
+  return second_run == first_run && before + first_run == "Rewind me please";
+}
+
+// The image carries no pointers, so it restores into devices at other
+// addresses with the peer wiring rebuilt from indices
+bool test_snapshot_relocates() {
+  static LINKED_PAIR source;
+  static LINKED_PAIR target;
+  UART_DEVICE *source_devices[] = {&source.uart_one, &source.uart_two};
+  UART_DEVICE *target_devices[] = {&target.uart_one, &target.uart_two};
+  queue_string(source.uart_one, "relocated");
+  std::string ignored;
+  run_pair(source, ignored, 33);
+
+  std::vector<uint8_t> image(snapshot_size(source_devices, 2, 0));
+  assert(snapshot_save(source_devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()) != 0);
+  // Through a plain byte copy, as a file read or mmap would hand it back
+  std::vector<uint8_t> loaded(image.begin(), image.end());
+  assert(snapshot_restore(target_devices, 2, nullptr, 0, loaded.data(), (uint32_t)loaded.size()));
+  assert(target.uart_one.tx_serial_connection == &target.uart_two.rx_buf);
+  assert(target.uart_two.tx_serial_connection == &target.uart_one.rx_buf);
+  assert(target.uart_one.tx_buf.storage() == target.one_tx);
+
+  std::string source_rest;
+  std::string target_rest;
+  run_pair(source, source_rest, 300);
+  run_pair(target, target_rest, 300);
+  return source_rest == target_rest && ignored + source_rest == "relocated";
+}
+
+bool test_snapshot_bus() {
+  static UART_DEVICE nodes[3];
+  static UART_BUS bus;
+  UART_DEVICE *devices[] = {&nodes[0], &nodes[1], &nodes[2]};
+  for (UART_DEVICE &node : nodes) {
+    node = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+    node.calculate_timing();
+    assert(serial_bus(bus, node));
+  }
+  assert(bus_enable_driver(bus, 0));
+  send_bit(nodes[0], 0);
+  send_bit(nodes[0], 1);
+
+  std::vector<uint8_t> image(snapshot_size(devices, 3, 1));
+  assert(snapshot_save(devices, 3, &bus, 1, image.data(), (uint32_t)image.size()) != 0);
+  bus_disable_driver(bus, 0);
+  bus_flush(bus, 1);
+  nodes[2].bus = nullptr;
+
+  assert(snapshot_restore(devices, 3, &bus, 1, image.data(), (uint32_t)image.size()));
+  assert(nodes[2].bus == &bus && nodes[2].bus_node == 2);
+  assert(bus.driver_mask == 1 && bus_pending(bus, 1) == 2);
+  return true;
+}
+
+bool test_snapshot_rejects_bad_images() {
+  static LINKED_PAIR pair;
+  UART_DEVICE *devices[] = {&pair.uart_one, &pair.uart_two};
+  std::vector<uint8_t> image(snapshot_size(devices, 2, 0));
+  assert(snapshot_save(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size() - 1) == 0);
+  assert(snapshot_save(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size()) != 0);
+
+  // Truncated, wrong magic and a device count mismatch
+  assert(!snapshot_restore(devices, 2, nullptr, 0, image.data(), (uint32_t)image.size() - 1));
+  std::vector<uint8_t> bad_magic = image;
+  bad_magic[0] ^= 0xFF;
+  assert(!snapshot_restore(devices, 2, nullptr, 0, bad_magic.data(), (uint32_t)bad_magic.size()));
+  assert(!snapshot_restore(devices, 1, nullptr, 0, image.data(), (uint32_t)image.size()));
+
+  // A bus node with no bus would have the engine follow a null bus pointer
+  std::vector<uint8_t> orphan_node = image;
+  orphan_node[sizeof(SNAPSHOT_HEADER) + offsetof(SNAPSHOT_DEVICE, bus_node)] = 3;
+  assert(!snapshot_restore(devices, 2, nullptr, 0, orphan_node.data(), (uint32_t)orphan_node.size()));
+  assert(pair.uart_one.bus_node == bus_no_node && pair.uart_one.bus == nullptr);
+
+  // Line settings the engine cannot run with
+  const size_t record = sizeof(SNAPSHOT_HEADER);
+  const size_t bad_fields[] = {offsetof(SNAPSHOT_DEVICE, data_bits), offsetof(SNAPSHOT_DEVICE, stop_bits),
+                               offsetof(SNAPSHOT_DEVICE, baud_rate), offsetof(SNAPSHOT_DEVICE, rx_fifo_depth)};
+  const uint32_t bad_values[] = {33, 3, 0, rx_fifo_capacity + 1};
+  for (uint32_t i = 0; i < 4; i++) {
+    std::vector<uint8_t> bad_config = image;
+    std::memcpy(&bad_config[record + bad_fields[i]], &bad_values[i], sizeof(uint32_t));
+    assert(!snapshot_restore(devices, 2, nullptr, 0, bad_config.data(), (uint32_t)bad_config.size()));
+    assert(pair.uart_one.config.data_bits == 8 && pair.uart_one.config.baud_rate == 9600);
+  }
+
+  // Derived timing is recomputed from the settings, the clock is kept
+  std::vector<uint8_t> bad_timing = image;
+  const double clock = 0.25;
+  const double wrong_time = 1.0;
+  const uint32_t wrong_bits = 99;
+  std::memcpy(&bad_timing[record + offsetof(SNAPSHOT_DEVICE, clock)], &clock, sizeof(clock));
+  std::memcpy(&bad_timing[record + offsetof(SNAPSHOT_DEVICE, time_per_byte)], &wrong_time, sizeof(wrong_time));
+  std::memcpy(&bad_timing[record + offsetof(SNAPSHOT_DEVICE, bits_per_frame)], &wrong_bits, sizeof(wrong_bits));
+  assert(snapshot_restore(devices, 2, nullptr, 0, bad_timing.data(), (uint32_t)bad_timing.size()));
+  assert(pair.uart_one.time_per_byte == 10.0 / 9600 && pair.uart_one.bits_per_frame == 10);
+  assert(pair.uart_one.clock == clock);
+
+  // Different buffer capacities cannot take the raw storage, nothing changes
+  static uint8_t small_tx[buf_capacity_small];
+  static uint8_t small_rx[buf_capacity_small];
+  UART_DEVICE other = {.state = DeviceState::IDLE, .config = default_config};
+  attach_buffers(other, small_tx, small_rx);
+  other.clock = 42.0;
+  UART_DEVICE *mismatched[] = {&other, &pair.uart_two};
+  assert(!snapshot_restore(mismatched, 2, nullptr, 0, image.data(), (uint32_t)image.size()));
+  assert(other.clock == 42.0 && other.tx_serial_connection == nullptr);
+
+  // Wired to a device outside the set, the link has no index
+  UART_DEVICE *partial[] = {&pair.uart_one};
+  std::vector<uint8_t> partial_image(snapshot_size(partial, 1, 0));
+  assert(snapshot_save(partial, 1, nullptr, 0, partial_image.data(), (uint32_t)partial_image.size()) == 0);
+  return true;
+}
+
+int main() {
+  if (test_snapshot_rewind()) {
+    std::cout << "Good: Snapshot Rewind" << std::endl;
+  } else {
+    std::cout << "Err: Snapshot Rewind" << std::endl;
+  }
+
+  if (test_snapshot_relocates()) {
+    std::cout << "Good: Snapshot Relocates" << std::endl;
+  } else {
+    std::cout << "Err: Snapshot Relocates" << std::endl;
+  }
+
+  if (test_snapshot_bus()) {
+    std::cout << "Good: Snapshot Bus" << std::endl;
+  }
+
+  if (test_snapshot_rejects_bad_images()) {
+    std::cout << "Good: Snapshot Rejects Bad Images" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
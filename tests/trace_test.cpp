@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/device.hpp"
+#include "../src/trace.hpp"
+
+constexpr UART_CONFIG default_config = {.baud_rate = 9600,
+  .data_bits = 8,
+  .stop_bits = 1,
+  .start_bits = 1, };
+
+static std::string trace_path(const char *tag) {
+  return "/tmp/uart_trace_test_" + std::to_string(getpid()) + "_" + tag + ".json";
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream in(path);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+static size_t count_of(const std::string &text, const std::string &needle) {
+  size_t count = 0;
+  for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + needle.size())) {
+    count++;
+  }
+  return count;
+}
+
+// Threads emit on their own tracks while the writer drains in the background
+bool test_trace_threads() {
+  constexpr int thread_count = 4;
+  constexpr int spans = 5000;
+  std::string path = trace_path("threads");
+  assert(trace_start(path.c_str()));
+  assert(!trace_start(path.c_str()));
+
+  static int sources[thread_count];
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t++) {
+    threads.emplace_back([t] {
+      trace_name(&sources[t], t == 0 ? "worker \"zero\"" : "worker");
+      for (int i = 0; i < spans; i++) {
+        trace_begin(&sources[t], "span", (uint32_t)i);
+        if (i % 100 == 0) {
+          trace_instant(&sources[t], "tick", (uint32_t)i);
+        }
+        trace_end(&sources[t], "span", (uint32_t)i);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  trace_stop();
+  // Stopped, nothing more is recorded
+  trace_begin(&sources[0], "late", 0);
+
+  std::string json = read_file(path);
+  std::remove(path.c_str());
+  assert(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+  assert(json.size() > 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+  assert(json.find("worker \\\"zero\\\"") != std::string::npos);
+  assert(json.find("late") == std::string::npos);
+  // A slow writer drops events, but every one is either written or counted
+  const size_t emitted = (size_t)thread_count * (2 * spans + spans / 100);
+  const size_t written =
+      count_of(json, "\"ph\":\"B\"") + count_of(json, "\"ph\":\"E\"") + count_of(json, "\"ph\":\"i\"");
+  return written > 0 && written + trace_dropped() == emitted;
+}
+
+// The engine hooks emit state and frame spans plus error instants when
+// compiled in, and nothing at all otherwise
+bool test_trace_device_hooks() {
+  static UART_DEVICE dev;
+  static UART_DEVICE other;
+  static uint8_t storage[4][buf_capacity_large];
+  dev = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+  other = UART_DEVICE{.state = DeviceState::IDLE, .config = default_config};
+  attach_buffers(dev, storage[0], storage[1]);
+  attach_buffers(other, storage[2], storage[3]);
+  serial_connection(dev, other);
+
+  std::string path = trace_path("device");
+  assert(trace_start(path.c_str()));
+  trace_name(&dev, "sender");
+  trace_name(&other, "receiver");
+  for (char character : std::string("hi")) {
+    assert(push_tx_byte(dev, (uint8_t)character));
+  }
+  for (int i = 0; i < 4; i++) {
+    service_device(dev);
+    service_device(other);
+  }
+  // A lone high bit is a bad start bit on the receiver
+  dev.tx_serial_connection->push(1);
+  service_device(other);
+  trace_stop();
+
+  std::string json = read_file(path);
+  std::remove(path.c_str());
+  assert(json.find("\"receiver\"") != std::string::npos);
+#if UART_TRACE
+  return count_of(json, "\"name\":\"tx frame\",\"ph\":\"B\"") == 2 &&
+         count_of(json, "\"name\":\"rx frame\",\"ph\":\"E\"") == 3 &&
+         count_of(json, "\"name\":\"TRANSMITTING\",\"ph\":\"B\"") == 2 &&
+         count_of(json, "\"name\":\"RECEIVING\",\"ph\":\"E\"") == 3 &&
+         count_of(json, "\"name\":\"frame error\",\"ph\":\"i\"") == 1;
+#else
+  return count_of(json, "\"ph\":\"B\"") == 0 && count_of(json, "\"ph\":\"i\"") == 0;
+#endif
+}
+
+int main() {
+  if (test_trace_threads()) {
+    std::cout << "Good: Trace Per Thread Buffers" << std::endl;
+  } else {
+    std::cout << "Err: Trace Per Thread Buffers" << std::endl;
+  }
+
+  if (test_trace_device_hooks()) {
+    std::cout << "Good: Trace Device Hooks" << std::endl;
+  } else {
+    std::cout << "Err: Trace Device Hooks" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
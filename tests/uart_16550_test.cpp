@@ -0,0 +1,176 @@
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+#include "../src/uart_16550.hpp"
+
+constexpr uint32_t discrete_time_step = 1;
+
+// Same init sequence a PC style driver would run
+static void driver_init(UART_16550 &uart, uint16_t divisor, uint8_t fcr) {
+  uart16550_write(uart, Reg16550::IER, 0x00);
+  uart16550_write(uart, Reg16550::LCR, lcr_dlab);
+  uart16550_write(uart, Reg16550::RBR_THR, (uint8_t)(divisor & 0xFF));
+  uart16550_write(uart, Reg16550::IER, (uint8_t)(divisor >> 8));
+  uart16550_write(uart, Reg16550::LCR, 0x03); // 8N1, DLAB off
+  uart16550_write(uart, Reg16550::IIR_FCR, fcr);
+  uart16550_write(uart, Reg16550::IER, ier_rx_data | ier_line_status);
+}
+
+bool test_16550_line_settings() {
+  UART_DEVICE dev = {.state = DeviceState::IDLE, .config = {}};
+  uint8_t tx_storage[buf_capacity_small];
+  uint8_t rx_storage[buf_capacity_small];
+  attach_buffers(dev, tx_storage, rx_storage);
+  UART_16550 uart;
+  uart16550_attach(uart, dev);
+
+  driver_init(uart, 12, fcr_enable | fcr_clear_rx | fcr_clear_tx | (2 << fcr_trigger_shift));
+  assert(dev.config.baud_rate == 9600);
+  assert(dev.config.data_bits == 8 && dev.config.stop_bits == 1);
+  assert(uart.rx_trigger == 8);
+  assert((uart16550_read(uart, Reg16550::IIR_FCR) & iir_fifo_enabled) == iir_fifo_enabled);
+  assert(uart16550_read(uart, Reg16550::IIR_FCR) & iir_no_interrupt);
+
+  uart16550_write(uart, Reg16550::SCR, 0x5A);
+  assert(uart16550_read(uart, Reg16550::SCR) == 0x5A);
+  assert(uart16550_read(uart, Reg16550::LSR) & lsr_thr_empty);
+  return true;
+}
+
+// A device starting from an empty config still gets a start bit in its frame
+bool test_16550_frame_timing() {
+  UART_DEVICE dev = {.state = DeviceState::IDLE, .config = {}};
+  uint8_t tx_storage[buf_capacity_small];
+  uint8_t rx_storage[buf_capacity_small];
+  attach_buffers(dev, tx_storage, rx_storage);
+  UART_16550 uart;
+  uart16550_attach(uart, dev);
+
+  driver_init(uart, 12, fcr_enable);
+  return dev.config.start_bits == 1 && dev.bits_per_frame == 10 && dev.time_per_byte == 10.0 / 9600;
+}
+
+bool test_16550_interrupt_driven_burst() {
+  UART_DEVICE host = {.state = DeviceState::IDLE, .config = {}};
+  UART_DEVICE target = {.state = DeviceState::IDLE, .config = {}};
+  uint8_t host_tx[buf_capacity_large];
+  uint8_t host_rx[buf_capacity_small];
+  uint8_t target_tx[buf_capacity_small];
+  uint8_t target_rx[buf_capacity_large];
+  attach_buffers(host, host_tx, host_rx);
+  attach_buffers(target, target_tx, target_rx);
+  serial_connection(host, target);
+
+  UART_16550 host_uart;
+  UART_16550 target_uart;
+  uart16550_attach(host_uart, host);
+  uart16550_attach(target_uart, target);
+  driver_init(host_uart, 1, fcr_enable);
+  driver_init(target_uart, 1, fcr_enable | (2 << fcr_trigger_shift));
+
+  std::string send_string("16550 FIFO burst read");
+  std::string received;
+  uint32_t rx_data_irqs = 0;
+  uint32_t timeout_irqs = 0;
+  uint32_t sent = 0;
+  int simulation_time = 100000;
+
+  while (simulation_time > 0 && received.size() < send_string.size()) {
+    // Keep the host TX FIFO topped up
+    sent += uart16550_write_burst(host_uart, reinterpret_cast<const uint8_t *>(send_string.data()) + sent,
+                                  (uint32_t)send_string.size() - sent);
+
+    uart16550_service(host_uart);
+    uart16550_service(target_uart);
+
+    // Interrupt service routine
+    while (uart16550_irq(target_uart)) {
+      uint8_t iir = uart16550_read(target_uart, Reg16550::IIR_FCR) & 0x0F;
+      assert(iir == iir_rx_data || iir == iir_char_timeout);
+      if (iir == iir_rx_data) {
+        rx_data_irqs++;
+      } else {
+        timeout_irqs++;
+      }
+      uint8_t burst[uart16550_fifo_depth];
+      uint32_t burst_size = uart16550_read_burst(target_uart, burst, uart16550_fifo_depth);
+      received.append(reinterpret_cast<char *>(burst), burst_size);
+    }
+
+    tick_down(host);
+    tick_down(target);
+    simulation_time -= discrete_time_step;
+  }
+
+  // 21 bytes at a trigger of 8: two full bursts, the tail drains on timeout
+  return received == send_string && rx_data_irqs == 2 && timeout_irqs == 1;
+}
+
+bool test_16550_overrun() {
+  UART_DEVICE host = {.state = DeviceState::IDLE, .config = {}};
+  UART_DEVICE target = {.state = DeviceState::IDLE, .config = {}};
+  uint8_t host_tx[buf_capacity_large];
+  uint8_t host_rx[buf_capacity_small];
+  uint8_t target_tx[buf_capacity_small];
+  uint8_t target_rx[buf_capacity_large];
+  attach_buffers(host, host_tx, host_rx);
+  attach_buffers(target, target_tx, target_rx);
+  serial_connection(host, target);
+
+  UART_16550 host_uart;
+  UART_16550 target_uart;
+  uart16550_attach(host_uart, host);
+  uart16550_attach(target_uart, target, 16);
+  driver_init(host_uart, 1, fcr_enable);
+  driver_init(target_uart, 1, fcr_enable);
+
+  uint8_t payload[20] = {};
+  for (uint8_t &value : payload) value = 0x41;
+  uint32_t sent = 0;
+  int simulation_time = 100000;
+  while (simulation_time > 0 && target.rx_overruns == 0) {
+    sent += uart16550_write_burst(host_uart, payload + sent, 20 - sent);
+    uart16550_service(host_uart);
+    uart16550_service(target_uart);
+    tick_down(host);
+    tick_down(target);
+    simulation_time -= discrete_time_step;
+  }
+
+  // Nobody drains the target, the 17th byte overruns the 16 byte FIFO
+  assert(target.rx_fifo.count() == 16);
+  assert(uart16550_irq(target_uart));
+  assert((uart16550_read(target_uart, Reg16550::IIR_FCR) & 0x0F) == iir_line_status);
+  uint8_t lsr = uart16550_read(target_uart, Reg16550::LSR);
+  (void)lsr;
+  assert((lsr & lsr_overrun) && (lsr & lsr_data_ready));
+  assert((uart16550_read(target_uart, Reg16550::LSR) & lsr_overrun) == 0);
+  return true;
+}
+
+int main() {
+  if (test_16550_line_settings()) {
+    std::cout << "Good: 16550 Line Settings" << std::endl;
+  }
+
+  if (test_16550_frame_timing()) {
+    std::cout << "Good: 16550 Frame Timing" << std::endl;
+  } else {
+    std::cout << "Err: 16550 Frame Timing" << std::endl;
+  }
+
+  if (test_16550_interrupt_driven_burst()) {
+    std::cout << "Good: 16550 Interrupt Driven Burst Read" << std::endl;
+  } else {
+    std::cout << "Err: 16550 Interrupt Driven Burst Read" << std::endl;
+  }
+
+  if (test_16550_overrun()) {
+    std::cout << "Good: 16550 Overrun" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
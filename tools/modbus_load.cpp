@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/modbus.hpp"
+
+// Drives a Modbus RTU master and its slaves over one multi-drop bus until a
+// number of transactions complete, then reports latency percentiles and
+// throughput, in simulated time and in emulator wall time.
+
+struct LOAD_OPTIONS {
+  uint32_t baud_rate = 19200;
+  uint32_t stop_bits = 2;       // RTU without parity uses two stop bits
+  uint32_t transactions = 1000;
+  MODBUS_WORKLOAD_CONFIG workload;
+};
+
+static void record_latency(double latency, void *ctx) { static_cast<std::vector<double> *>(ctx)->push_back(latency); }
+
+// Nearest rank on sorted samples, rounded up like latency_percentile()
+static double percentile(const std::vector<double> &sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const double exact = fraction * (double)sorted.size();
+  size_t rank = exact > 0.0 ? (size_t)exact : 0;
+  if ((double)rank < exact) {
+    rank++;
+  }
+  if (rank == 0) {
+    rank = 1;
+  }
+  if (rank > sorted.size()) {
+    rank = sorted.size();
+  }
+  return sorted[rank - 1];
+}
+
+static void print_usage() {
+  std::cerr << "usage: tool_modbus_load [--baud N] [--stop N] [--slaves N] [--transactions N] [--max-read N]\n"
+               "                        [--write-percent N] [--bad-address-percent N] [--timeout-chars N] [--seed N]"
+            << std::endl;
+}
+
+static bool parse_args(int argc, char **argv, LOAD_OPTIONS &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string flag(argv[i]);
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    uint64_t number = std::strtoull(value, nullptr, 0);
+    if (flag == "--baud") {
+      options.baud_rate = (uint32_t)number;
+    } else if (flag == "--stop") {
+      options.stop_bits = (uint32_t)number;
+    } else if (flag == "--slaves") {
+      options.workload.slave_count = (uint32_t)number;
+    } else if (flag == "--transactions") {
+      options.transactions = (uint32_t)number;
+    } else if (flag == "--max-read") {
+      options.workload.max_read = (uint32_t)number;
+    } else if (flag == "--write-percent") {
+      options.workload.write_percent = (uint32_t)number;
+    } else if (flag == "--bad-address-percent") {
+      options.workload.bad_address_percent = (uint32_t)number;
+    } else if (flag == "--timeout-chars") {
+      options.workload.timeout_chars = (uint32_t)number;
+    } else if (flag == "--seed") {
+      options.workload.seed = number;
+    } else {
+      return false;
+    }
+  }
+  return options.baud_rate != 0 && (options.stop_bits == 1 || options.stop_bits == 2) &&
+         options.transactions != 0;
+}
+
+int main(int argc, char **argv) {
+  LOAD_OPTIONS options;
+  if (!parse_args(argc, argv, options)) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  const UART_CONFIG config = {.baud_rate = options.baud_rate,
+    .data_bits = 8,
+    .stop_bits = options.stop_bits,
+    .start_bits = 1, };
+  const uint32_t device_count = options.workload.slave_count + 1;
+  std::unique_ptr<UART_DEVICE[]> devices = std::make_unique<UART_DEVICE[]>(device_count);
+  std::vector<uint8_t> storage((size_t)device_count * buf_capacity_large * 2);
+  std::vector<UART_DEVICE *> slaves;
+  for (uint32_t i = 0; i < device_count; i++) {
+    devices[i].config = config;
+    devices[i].calculate_timing();
+    attach_buffers(devices[i], &storage[(size_t)i * 2 * buf_capacity_large], buf_capacity_large,
+                   &storage[((size_t)i * 2 + 1) * buf_capacity_large], buf_capacity_large);
+    if (i > 0) {
+      slaves.push_back(&devices[i]);
+    }
+  }
+
+  static UART_BUS bus;
+  static MODBUS_WORKLOAD workload;
+  if (!modbus_workload_init(workload, bus, devices[0], slaves.data(), options.workload)) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+  std::vector<double> latencies;
+  latencies.reserve(options.transactions);
+  workload.latency_handler = record_latency;
+  workload.latency_ctx = &latencies;
+
+  // A run where every request times out still ends
+  const uint64_t tick_limit = (uint64_t)options.transactions *
+                              ((uint64_t)((options.workload.timeout_chars + 2 * modbus_max_adu) *
+                                          devices[0].time_per_byte / time_step) + 100);
+  auto start = std::chrono::steady_clock::now();
+  while (workload.stats.transactions + workload.stats.timeouts < options.transactions && workload.ticks < tick_limit) {
+    modbus_workload_step(workload);
+  }
+  double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  const MODBUS_STATS &stats = workload.stats;
+  double sim_seconds = workload.now;
+  std::printf("modbus rtu: %u baud 8N%u, %u slaves, t1.5 %.3f ms, t3.5 %.3f ms\n", options.baud_rate,
+              options.stop_bits, options.workload.slave_count, workload.timing.t1_5 * 1e3, workload.timing.t3_5 * 1e3);
+  std::printf("  requests %u, answered %u (exceptions %u), timeouts %u, bad responses %u\n", stats.requests,
+              stats.transactions, stats.exceptions, stats.timeouts, stats.bad_responses);
+  std::printf("  crc errors %u, broken frames %u, bus collisions %u\n", stats.crc_errors, stats.broken_frames,
+              bus.collisions);
+  std::printf("  latency ms: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f  mean %.3f\n",
+              percentile(latencies, 0.50) * 1e3, percentile(latencies, 0.90) * 1e3, percentile(latencies, 0.99) * 1e3,
+              percentile(latencies, 0.999) * 1e3, stats.latency_max * 1e3,
+              stats.transactions != 0 ? stats.latency_total / stats.transactions * 1e3 : 0.0);
+  std::printf("  simulated: %.3f s, %.1f transactions/s\n", sim_seconds,
+              sim_seconds > 0.0 ? stats.transactions / sim_seconds : 0.0);
+  std::printf("  wall: %.3f s, %.1f transactions/s, %.1fx real time\n", wall_seconds,
+              wall_seconds > 0.0 ? stats.transactions / wall_seconds : 0.0,
+              wall_seconds > 0.0 ? sim_seconds / wall_seconds : 0.0);
+  return stats.transactions != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,391 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../src/device.hpp"
+
+// Expands a grid of line settings, buffer sizes and link error rates into
+// independent two device simulations and runs them on every core. Each
+// worker owns a deque of grid points and steals from the others once it runs
+// dry, so a slow corner of the grid (low baud, high error rate) does not
+// leave the rest of the machine idle. One CSV or JSON row per grid point,
+// printed in grid order.
+
+struct SWEEP_POINT {
+  uint32_t baud_rate;
+  uint32_t data_bits;
+  uint32_t stop_bits;
+  uint32_t tx_buf_bits;
+  uint32_t rx_buf_bits;
+  double error_rate;  // Probability a line bit is flipped in flight
+};
+
+struct SWEEP_RESULT {
+  uint32_t bytes_sent = 0;
+  uint32_t bytes_received = 0;
+  uint32_t bytes_intact = 0;
+  uint32_t bytes_corrupted = 0;
+  uint32_t bytes_lost = 0;
+  uint32_t bits_flipped = 0;
+  uint32_t frame_errors = 0;
+  uint32_t rx_overruns = 0;
+  uint64_t ticks = 0;
+  double wall_ms = 0.0;
+};
+
+struct SWEEP_OPTIONS {
+  std::vector<uint32_t> baud_rates = {9600, 19200, 57600, 115200};
+  std::vector<uint32_t> data_bits = {7, 8};
+  std::vector<uint32_t> stop_bits = {1, 2};
+  std::vector<uint32_t> tx_buf_bits = {buf_capacity_small, buf_capacity_large};
+  std::vector<uint32_t> rx_buf_bits = {buf_capacity_small, buf_capacity_large};
+  std::vector<double> error_rates = {0.0, 1e-4, 1e-3};
+  uint32_t payload_bytes = 256;
+  uint32_t threads = 0;
+  uint64_t seed = 0x9E3779B97F4A7C15ull;
+  bool json = false;
+};
+
+// How far ahead a received byte is matched before it counts as corrupted,
+// lets the checker resync after frames dropped on errors or overruns
+constexpr uint32_t resync_window = 4;
+
+static uint64_t xorshift64(uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+// Flips each bit that landed in rx_buf since the last call with the point's
+// error rate, the sender has already pushed them so this is the wire
+static uint32_t inject_errors(UART_DEVICE &dev, uint32_t &seen, double error_rate, uint64_t &rng) {
+  uint32_t count = dev.rx_buf.count();
+  uint32_t flipped = 0;
+  if (error_rate > 0.0 && count > seen) {
+    uint8_t *storage = dev.rx_buf.storage();
+    uint32_t mask = dev.rx_buf.capacity() - 1;
+    uint64_t threshold = (uint64_t)(error_rate * 18446744073709551616.0);
+    for (uint32_t i = seen; i < count; i++) {
+      if (xorshift64(rng) < threshold) {
+        storage[(dev.rx_buf.front_index() + i) & mask] ^= 0x01;
+        flipped++;
+      }
+    }
+  }
+  seen = count;
+  return flipped;
+}
+
+static SWEEP_RESULT run_point(const SWEEP_POINT &point, uint32_t payload_bytes, uint64_t seed) {
+  auto start = std::chrono::steady_clock::now();
+  SWEEP_RESULT result;
+
+  const UART_CONFIG config = {.baud_rate = point.baud_rate,
+    .data_bits = point.data_bits,
+    .stop_bits = point.stop_bits,
+    .start_bits = 1, };
+  UART_DEVICE sender = {.state = DeviceState::IDLE, .config = config};
+  UART_DEVICE receiver = {.state = DeviceState::IDLE, .config = config};
+  std::vector<uint8_t> storage(point.tx_buf_bits * 2 + point.rx_buf_bits * 2);
+  attach_buffers(sender, storage.data(), point.tx_buf_bits, storage.data() + point.tx_buf_bits, point.rx_buf_bits);
+  attach_buffers(receiver, storage.data() + point.tx_buf_bits + point.rx_buf_bits, point.tx_buf_bits,
+                 storage.data() + point.tx_buf_bits * 2 + point.rx_buf_bits, point.rx_buf_bits);
+  sender.calculate_timing();
+  receiver.calculate_timing();
+  serial_connection(sender, receiver);
+
+  uint64_t rng = seed | 1;
+  const uint8_t value_mask = (uint8_t)((1u << point.data_bits) - 1);
+  std::vector<uint8_t> payload(payload_bytes);
+  for (uint8_t &value : payload) {
+    value = (uint8_t)xorshift64(rng) & value_mask;
+  }
+
+  // Enough ticks for every frame four times over, a stuck link ends the run
+  uint64_t ticks_per_frame = (uint64_t)(sender.time_per_byte / time_step) + 1;
+  uint64_t tick_limit = ticks_per_frame * payload_bytes * 4 + 1000;
+  uint32_t rx_seen = 0;
+  uint32_t expected = 0;
+  uint8_t received[rx_fifo_capacity];
+
+  while (result.ticks < tick_limit) {
+    while (result.bytes_sent < payload_bytes && push_tx_byte(sender, payload[result.bytes_sent])) {
+      result.bytes_sent++;
+    }
+    if (result.bytes_sent == payload_bytes && sender.tx_buf.count() < sender.config.data_bits &&
+        receiver.rx_buf.count() < receiver.bits_per_frame) {
+      break;
+    }
+
+    service_device(sender);
+    result.bits_flipped += inject_errors(receiver, rx_seen, point.error_rate, rng);
+    service_device(receiver);
+    rx_seen = receiver.rx_buf.count();
+
+    uint32_t count = read_rx_fifo(receiver, received, rx_fifo_capacity);
+    for (uint32_t i = 0; i < count; i++) {
+      result.bytes_received++;
+      uint32_t ahead = 0;
+      while (ahead < resync_window && expected + ahead < payload_bytes &&
+             payload[expected + ahead] != received[i]) {
+        ahead++;
+      }
+      if (ahead < resync_window && expected + ahead < payload_bytes) {
+        result.bytes_intact++;
+        expected += ahead + 1;
+      } else {
+        result.bytes_corrupted++;
+        expected++;
+      }
+    }
+
+    tick_down(sender);
+    tick_down(receiver);
+    result.ticks++;
+  }
+
+  result.bytes_lost = payload_bytes > result.bytes_intact + result.bytes_corrupted
+                          ? payload_bytes - result.bytes_intact - result.bytes_corrupted
+                          : 0;
+  result.frame_errors = receiver.frame_errors;
+  result.rx_overruns = receiver.rx_overruns;
+  result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+// ---- Work stealing ----
+
+struct WORK_QUEUE {
+  std::mutex lock;
+  std::deque<uint32_t> items;
+};
+
+// Owner takes from the back, keeping the points it was handed together
+static bool pop_local(WORK_QUEUE &queue, uint32_t &item) {
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if (queue.items.empty()) {
+    return false;
+  }
+  item = queue.items.back();
+  queue.items.pop_back();
+  return true;
+}
+
+// Thieves take from the front, the far end of the victim's range
+static bool steal(WORK_QUEUE &queue, uint32_t &item) {
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if (queue.items.empty()) {
+    return false;
+  }
+  item = queue.items.front();
+  queue.items.pop_front();
+  return true;
+}
+
+static void run_worker(uint32_t worker, std::vector<WORK_QUEUE> &queues, const std::vector<SWEEP_POINT> &points,
+                       std::vector<SWEEP_RESULT> &results, const SWEEP_OPTIONS &options,
+                       std::atomic<uint32_t> &steals) {
+  const uint32_t worker_count = (uint32_t)queues.size();
+  uint32_t item = 0;
+  while (true) {
+    bool found = pop_local(queues[worker], item);
+    for (uint32_t offset = 1; !found && offset < worker_count; offset++) {
+      found = steal(queues[(worker + offset) % worker_count], item);
+      if (found) {
+        steals.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    // Nothing is ever queued after start, so empty everywhere means done
+    if (!found) {
+      return;
+    }
+    results[item] = run_point(points[item], options.payload_bytes, options.seed ^ ((uint64_t)item * 0x100000001B3ull));
+  }
+}
+
+// ---- Grid, arguments and output ----
+
+static std::vector<SWEEP_POINT> expand_grid(const SWEEP_OPTIONS &options) {
+  std::vector<SWEEP_POINT> points;
+  for (uint32_t baud_rate : options.baud_rates)
+    for (uint32_t data_bits : options.data_bits)
+      for (uint32_t stop_bits : options.stop_bits)
+        for (uint32_t tx_buf_bits : options.tx_buf_bits)
+          for (uint32_t rx_buf_bits : options.rx_buf_bits)
+            for (double error_rate : options.error_rates)
+              points.push_back({baud_rate, data_bits, stop_bits, tx_buf_bits, rx_buf_bits, error_rate});
+  return points;
+}
+
+template <typename T>
+static bool parse_list(const char *arg, std::vector<T> &out) {
+  out.clear();
+  std::string text(arg);
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    std::string item = text.substr(start, end - start);
+    char *parse_end = nullptr;
+    if (item.empty()) {
+      return false;
+    }
+    if constexpr (std::is_same_v<T, double>) {
+      out.push_back(std::strtod(item.c_str(), &parse_end));
+    } else {
+      out.push_back((T)std::strtoul(item.c_str(), &parse_end, 10));
+    }
+    if (*parse_end != '\0') {
+      return false;
+    }
+    start = end + 1;
+  }
+  return !out.empty();
+}
+
+static bool is_power_of_two(uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+static void print_usage() {
+  std::cerr << "usage: tool_sweep [--baud LIST] [--data LIST] [--stop LIST] [--tx-buf LIST] [--rx-buf LIST]\n"
+               "                  [--error LIST] [--bytes N] [--threads N] [--seed N] [--format csv|json]\n"
+               "LIST is comma separated, buffer sizes are bits and must be powers of two" << std::endl;
+}
+
+static bool parse_args(int argc, char **argv, SWEEP_OPTIONS &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string flag(argv[i]);
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    bool ok = true;
+    if (flag == "--baud") {
+      ok = parse_list(value, options.baud_rates);
+    } else if (flag == "--data") {
+      ok = parse_list(value, options.data_bits);
+    } else if (flag == "--stop") {
+      ok = parse_list(value, options.stop_bits);
+    } else if (flag == "--tx-buf") {
+      ok = parse_list(value, options.tx_buf_bits);
+    } else if (flag == "--rx-buf") {
+      ok = parse_list(value, options.rx_buf_bits);
+    } else if (flag == "--error") {
+      ok = parse_list(value, options.error_rates);
+    } else if (flag == "--bytes") {
+      options.payload_bytes = (uint32_t)std::strtoul(value, nullptr, 10);
+    } else if (flag == "--threads") {
+      options.threads = (uint32_t)std::strtoul(value, nullptr, 10);
+    } else if (flag == "--seed") {
+      options.seed = std::strtoull(value, nullptr, 0);
+    } else if (flag == "--format") {
+      options.json = std::string(value) == "json";
+      ok = options.json || std::string(value) == "csv";
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  for (uint32_t bits : options.data_bits) {
+    if (bits == 0 || bits > 8) return false;
+  }
+  for (uint32_t bits : options.tx_buf_bits) {
+    if (!is_power_of_two(bits)) return false;
+  }
+  for (uint32_t bits : options.rx_buf_bits) {
+    if (!is_power_of_two(bits)) return false;
+  }
+  for (uint32_t baud_rate : options.baud_rates) {
+    if (baud_rate == 0) return false;
+  }
+  return true;
+}
+
+static void print_row(const SWEEP_POINT &point, const SWEEP_RESULT &result, bool json) {
+  double sim_seconds = (double)result.ticks * time_step;
+  double goodput_bps = sim_seconds > 0.0 ? (double)result.bytes_intact * point.data_bits / sim_seconds : 0.0;
+  char line[512];
+  if (json) {
+    std::snprintf(line, sizeof(line),
+                  "{\"baud\":%u,\"data_bits\":%u,\"stop_bits\":%u,\"tx_buf_bits\":%u,\"rx_buf_bits\":%u,"
+                  "\"error_rate\":%g,\"bytes_sent\":%u,\"bytes_received\":%u,\"bytes_intact\":%u,"
+                  "\"bytes_corrupted\":%u,\"bytes_lost\":%u,\"bits_flipped\":%u,\"frame_errors\":%u,"
+                  "\"rx_overruns\":%u,\"ticks\":%llu,\"sim_seconds\":%.6f,\"goodput_bps\":%.1f,\"wall_ms\":%.3f}",
+                  point.baud_rate, point.data_bits, point.stop_bits, point.tx_buf_bits, point.rx_buf_bits,
+                  point.error_rate, result.bytes_sent, result.bytes_received, result.bytes_intact,
+                  result.bytes_corrupted, result.bytes_lost, result.bits_flipped, result.frame_errors,
+                  result.rx_overruns, (unsigned long long)result.ticks, sim_seconds, goodput_bps, result.wall_ms);
+  } else {
+    std::snprintf(line, sizeof(line), "%u,%u,%u,%u,%u,%g,%u,%u,%u,%u,%u,%u,%u,%u,%llu,%.6f,%.1f,%.3f",
+                  point.baud_rate, point.data_bits, point.stop_bits, point.tx_buf_bits, point.rx_buf_bits,
+                  point.error_rate, result.bytes_sent, result.bytes_received, result.bytes_intact,
+                  result.bytes_corrupted, result.bytes_lost, result.bits_flipped, result.frame_errors,
+                  result.rx_overruns, (unsigned long long)result.ticks, sim_seconds, goodput_bps, result.wall_ms);
+  }
+  std::cout << line << '\n';
+}
+
+int main(int argc, char **argv) {
+  SWEEP_OPTIONS options;
+  if (!parse_args(argc, argv, options)) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  std::vector<SWEEP_POINT> points = expand_grid(options);
+  std::vector<SWEEP_RESULT> results(points.size());
+  uint32_t worker_count = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+  if (worker_count == 0) {
+    worker_count = 1;
+  }
+  if (worker_count > points.size()) {
+    worker_count = points.size() > 0 ? (uint32_t)points.size() : 1;
+  }
+
+  // Contiguous ranges so each worker starts on neighbouring grid points,
+  // stealing evens out the ranges that turn out slower
+  std::vector<WORK_QUEUE> queues(worker_count);
+  for (uint32_t i = 0; i < points.size(); i++) {
+    queues[(uint64_t)i * worker_count / points.size()].items.push_back(i);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<uint32_t> steals{0};
+  std::vector<std::thread> workers;
+  for (uint32_t worker = 0; worker < worker_count; worker++) {
+    workers.emplace_back(run_worker, worker, std::ref(queues), std::cref(points), std::ref(results),
+                         std::cref(options), std::ref(steals));
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (!options.json) {
+    std::cout << "baud,data_bits,stop_bits,tx_buf_bits,rx_buf_bits,error_rate,bytes_sent,bytes_received,"
+                 "bytes_intact,bytes_corrupted,bytes_lost,bits_flipped,frame_errors,rx_overruns,ticks,"
+                 "sim_seconds,goodput_bps,wall_ms\n";
+  }
+  for (uint32_t i = 0; i < points.size(); i++) {
+    print_row(points[i], results[i], options.json);
+  }
+  std::cout.flush();
+  std::cerr << points.size() << " points on " << worker_count << " threads in " << wall_ms << " ms, " << steals.load()
+            << " steals" << std::endl;
+  return EXIT_SUCCESS;
+}